@@ -0,0 +1,61 @@
+/**@file Benchmark.h
+ * A minimal benchmark harness, used to track the throughput of the decoders.
+ */
+#pragma once
+
+#include <stddef.h>
+#include <Platform.h>
+#include <Vector.h>
+#include <functional>
+#include <string>
+
+namespace WorldStone
+{
+namespace Benchmarks
+{
+
+/// Amount of work done by one iteration of a benchmark, used to compute the throughputs
+struct Work
+{
+    size_t bytes = 0; ///< Number of bytes produced (or consumed for readers) by the iteration
+    size_t items = 0; ///< Number of items (frames, values...) processed by the iteration
+};
+
+/// Information given to the benchmarks setup
+struct Context
+{
+    std::string dataDirectory; ///< Directory containing the sample files
+};
+
+/// One iteration of a benchmark, this is what is measured
+using Iteration = std::function<Work()>;
+
+/**Prepares the data used by a benchmark, outside of the measures.
+ * @return The iteration to measure, or an empty function if the benchmark can not run.
+ */
+using Setup = std::function<Iteration(const Context&)>;
+
+struct Benchmark
+{
+    std::string name;      ///< Unique name, in the form Category/Name
+    std::string itemsName; ///< What the items of @ref Work are, eg: "frames"
+    Setup       setup;
+};
+
+void registerBitStreamBenchmarks(Vector<Benchmark>& benchmarks);
+void registerDecodersBenchmarks(Vector<Benchmark>& benchmarks);
+
+/// Prevents the compiler from optimizing away the computation of a value
+template<class T>
+inline void doNotOptimize(const T& value)
+{
+#if defined(WS_GCC_FAMILY)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    const volatile char* volatile sink = reinterpret_cast<const volatile char*>(&value);
+    (void)*sink;
+#endif
+}
+
+} // namespace Benchmarks
+} // namespace WorldStone
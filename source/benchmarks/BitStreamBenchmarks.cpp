@@ -0,0 +1,85 @@
+/**@file BitStreamBenchmarks.cpp
+ * Micro-benchmarks of the BitStreamView reads
+ */
+
+#include <BitStream.h>
+#include <fmt/format.h>
+#include <memory>
+#include "Benchmark.h"
+
+namespace WorldStone
+{
+namespace Benchmarks
+{
+
+namespace
+{
+constexpr size_t streamSizeInBytes = 1 << 20;
+
+/// Random bytes, padded as required by BitStreamView
+std::shared_ptr<Vector<uint8_t>> makeRandomBuffer()
+{
+    auto     buffer = std::make_shared<Vector<uint8_t>>(streamSizeInBytes +
+                                                    BitStreamView::tailPaddingBytes);
+    uint32_t seed   = 0x12345678;
+    for (uint8_t& byte : *buffer)
+    {
+        seed = seed * 1664525u + 1013904223u; // LCG, good enough for benchmark data
+        byte = uint8_t(seed >> 24);
+    }
+    return buffer;
+}
+
+Benchmark readUnsignedBenchmark(unsigned nbBits)
+{
+    return {fmt::format("BitStream/readUnsigned({})", nbBits), "values",
+            [nbBits](const Context&) -> Iteration {
+                auto buffer = makeRandomBuffer();
+                return [buffer, nbBits]() {
+                    BitStreamView bitstream{buffer->data(), streamSizeInBytes * CHAR_BIT};
+                    const size_t  nbReads = bitstream.sizeInBits() / nbBits;
+                    uint32_t      sum     = 0;
+                    for (size_t i = 0; i < nbReads; i++)
+                    {
+                        sum += bitstream.readUnsigned(nbBits);
+                    }
+                    doNotOptimize(sum);
+                    return Work{nbReads * nbBits / CHAR_BIT, nbReads};
+                };
+            }};
+}
+
+Benchmark readUnsigned8OrLessBenchmark(int nbBits)
+{
+    return {fmt::format("BitStream/readUnsigned8OrLess({})", nbBits), "values",
+            [nbBits](const Context&) -> Iteration {
+                auto buffer = makeRandomBuffer();
+                return [buffer, nbBits]() {
+                    BitStreamView bitstream{buffer->data(), streamSizeInBytes * CHAR_BIT};
+                    const size_t  nbReads = bitstream.sizeInBits() / size_t(nbBits);
+                    uint32_t      sum     = 0;
+                    for (size_t i = 0; i < nbReads; i++)
+                    {
+                        sum += bitstream.readUnsigned8OrLess(nbBits);
+                    }
+                    doNotOptimize(sum);
+                    return Work{nbReads * size_t(nbBits) / CHAR_BIT, nbReads};
+                };
+            }};
+}
+} // anonymous namespace
+
+void registerBitStreamBenchmarks(Vector<Benchmark>& benchmarks)
+{
+    // Typical sizes of the DCC streams
+    for (unsigned nbBits : {1u, 4u, 13u, 32u})
+    {
+        benchmarks.push_back(readUnsignedBenchmark(nbBits));
+    }
+    for (int nbBits : {1, 4, 8})
+    {
+        benchmarks.push_back(readUnsigned8OrLessBenchmark(nbBits));
+    }
+}
+} // namespace Benchmarks
+} // namespace WorldStone
@@ -0,0 +1,192 @@
+/**@file DecodersBenchmarks.cpp
+ * Benchmarks of the sprite decoders
+ */
+
+#include <FileStream.h>
+#include <ImageView.h>
+#include <MemoryStream.h>
+#include <ThreadPool.h>
+#include <dc6.h>
+#include <dcc.h>
+#include <string.h>
+#include <algorithm>
+#include <memory>
+#include "Benchmark.h"
+
+namespace WorldStone
+{
+namespace Benchmarks
+{
+
+namespace
+{
+/// Loads a whole file in memory so that the benchmarks do not measure the I/O
+std::shared_ptr<Vector<uint8_t>> loadFile(const std::string& path)
+{
+    FileStream file{path};
+    if (!file.is_open()) return nullptr;
+    MemoryStream memory{file};
+    if (!memory.good()) return nullptr;
+    return std::make_shared<Vector<uint8_t>>(memory.getBuffer());
+}
+
+/// Decodes all the directions of a DCC file
+Benchmark dccBenchmark(const char* fileName)
+{
+    return {std::string("DCC/") + fileName, "frames", [fileName](const Context& context) {
+                auto file = loadFile(context.dataDirectory + "/" + fileName);
+                if (!file) return Iteration{};
+                return Iteration{[file]() {
+                    Work work;
+                    DCC  dcc;
+                    if (!dcc.initDecoder(std::make_unique<SpanStream>(file->data(), file->size())))
+                        return work;
+                    for (uint32_t dir = 0; dir < dcc.getHeader().directions; dir++)
+                    {
+                        DCC::Direction               direction;
+                        SimpleImageProvider<uint8_t> imgProvider;
+                        if (!dcc.readDirection(direction, dir, imgProvider)) return Work{};
+                        for (size_t frame = 0; frame < imgProvider.getImagesNumber(); frame++)
+                        {
+                            const ImageView<uint8_t> image = imgProvider.getImage(frame);
+                            work.bytes += image.width * image.height;
+                        }
+                        work.items += imgProvider.getImagesNumber();
+                    }
+                    return work;
+                }};
+            }};
+}
+
+/**Generates a DC6 file with frames made of alternating transparent and color runs.
+ * There is no DC6 file in the samples, and the RLE decoding does not depend on the content.
+ */
+Vector<uint8_t> makeDC6File(uint32_t nbFrames, int32_t width, int32_t height)
+{
+    Vector<uint8_t> file(sizeof(DC6::Header) + nbFrames * sizeof(uint32_t));
+    DC6::Header     header = {6, 1, 0, {0xEE, 0xEE, 0xEE, 0xEE}, 1, nbFrames};
+    memcpy(file.data(), &header, sizeof(header));
+
+    uint32_t seed = 0x12345678;
+    auto     rand = [&seed](uint32_t max) {
+        seed = seed * 1664525u + 1013904223u;
+        return 1 + (seed >> 16) % max;
+    };
+    for (uint32_t frame = 0; frame < nbFrames; frame++)
+    {
+        const uint32_t framePointer = uint32_t(file.size());
+        memcpy(file.data() + sizeof(header) + frame * sizeof(uint32_t), &framePointer,
+               sizeof(framePointer));
+        Vector<uint8_t> data;
+        for (int32_t y = 0; y < height; y++)
+        {
+            for (int32_t x = 0; x < width;)
+            {
+                const uint32_t transparentPixels = std::min(rand(20), uint32_t(width - x));
+                data.push_back(uint8_t(0x80 | transparentPixels));
+                x += int32_t(transparentPixels);
+                const uint32_t colors = std::min(rand(60), uint32_t(width - x));
+                if (colors == 0) break;
+                data.push_back(uint8_t(colors));
+                for (uint32_t i = 0; i < colors; i++)
+                {
+                    data.push_back(uint8_t(rand(255)));
+                }
+                x += int32_t(colors);
+            }
+            data.push_back(0x80); // End of line
+        }
+        DC6::FrameHeader frameHeader = {0, width, height, 0, 0, 0, 0, int32_t(data.size())};
+        const size_t     headerPos   = file.size();
+        file.resize(headerPos + sizeof(frameHeader));
+        memcpy(file.data() + headerPos, &frameHeader, sizeof(frameHeader));
+        file.insert(file.end(), data.begin(), data.end());
+    }
+    return file;
+}
+
+Benchmark dc6Benchmark()
+{
+    return {"DC6/RLE 32x(256x256)", "frames", [](const Context&) {
+                const uint32_t nbFrames = 32;
+                const int32_t  size     = 256;
+                auto file   = std::make_shared<Vector<uint8_t>>(makeDC6File(nbFrames, size, size));
+                auto pixels = std::make_shared<Vector<uint8_t>>(size_t(size * size));
+                return Iteration{[file, pixels, nbFrames]() {
+                    DC6 dc6;
+                    if (!dc6.initDecoder(std::make_unique<SpanStream>(file->data(), file->size())))
+                        return Work{};
+                    Work work;
+                    for (uint32_t frame = 0; frame < nbFrames; frame++)
+                    {
+                        if (!dc6.decompressFrameIn(frame, pixels->data())) return Work{};
+                        work.bytes += pixels->size();
+                        work.items++;
+                    }
+                    return work;
+                }};
+            }};
+}
+
+/// Same as dc6Benchmark, but decodes all the frames at once with DC6::decompressAll
+Benchmark dc6ParallelBenchmark()
+{
+    return {"DC6/RLE 32x(256x256) parallel", "frames", [](const Context&) {
+                const uint32_t nbFrames = 32;
+                const int32_t  size     = 256;
+                auto file = std::make_shared<Vector<uint8_t>>(makeDC6File(nbFrames, size, size));
+                auto pool = std::make_shared<ThreadPool>();
+                return Iteration{[file, pool]() {
+                    DC6 dc6;
+                    if (!dc6.initDecoder(std::make_unique<SpanStream>(file->data(), file->size())))
+                        return Work{};
+                    SimpleImageProvider<uint8_t> imgProvider;
+                    if (!dc6.decompressAll(imgProvider, *pool)) return Work{};
+                    Work work;
+                    for (size_t frame = 0; frame < imgProvider.getImagesNumber(); frame++)
+                    {
+                        const ImageView<uint8_t> image = imgProvider.getImage(frame);
+                        work.bytes += image.width * image.height;
+                    }
+                    work.items += imgProvider.getImagesNumber();
+                    return work;
+                }};
+            }};
+}
+
+/// Composes layers of a sprite, half of the pixels being transparent
+Benchmark blitTransparentBenchmark()
+{
+    return {"ImageView/blitTransparent 512x512", "images", [](const Context&) {
+                const size_t size        = 512;
+                auto         source      = std::make_shared<Vector<uint8_t>>(size * size);
+                auto         destination = std::make_shared<Vector<uint8_t>>(size * size);
+                for (size_t i = 0; i < source->size(); i++)
+                {
+                    (*source)[i] = (i / 7) % 2 ? uint8_t(i) : 0;
+                }
+                return Iteration{[source, destination, size]() {
+                    blitTransparent({source->data(), size, size, size},
+                                    {destination->data(), size, size, size});
+                    Work work;
+                    work.bytes += source->size();
+                    work.items++;
+                    return work;
+                }};
+            }};
+}
+} // anonymous namespace
+
+void registerDecodersBenchmarks(Vector<Benchmark>& benchmarks)
+{
+    for (const char* fileName :
+         {"BaalSpirit.dcc", "BloodSmall01.dcc", "CRHDBRVDTHTH.dcc", "HZTRLITA1HTH.dcc"})
+    {
+        benchmarks.push_back(dccBenchmark(fileName));
+    }
+    benchmarks.push_back(dc6Benchmark());
+    benchmarks.push_back(dc6ParallelBenchmark());
+    benchmarks.push_back(blitTransparentBenchmark());
+}
+} // namespace Benchmarks
+} // namespace WorldStone
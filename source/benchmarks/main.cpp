@@ -0,0 +1,180 @@
+/**@file main.cpp
+ * Runs the benchmarks and reports their throughput, optionally as JSON.
+ *
+ * Usage: ws_benchmarks [--filter=text] [--min-time=seconds] [--data-dir=path] [--json=file]
+ */
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+#include <chrono>
+#include <fmt/format.h>
+#include "Benchmark.h"
+
+using namespace WorldStone::Benchmarks;
+using WorldStone::Vector;
+
+namespace
+{
+
+struct Options
+{
+    std::string filter;              ///< Only run the benchmarks whose name contain this text
+    std::string jsonPath;            ///< Where to write the JSON report, "-" for stdout
+    double      minTime       = 0.5; ///< Minimum time spent measuring each benchmark, in seconds
+    size_t      minIterations = 5;
+    Context     context;
+};
+
+struct Result
+{
+    std::string name;
+    std::string itemsName;
+    size_t      iterations;
+    double      medianSeconds; ///< Median duration of an iteration
+    double      minSeconds;    ///< Fastest iteration
+    double      bytesPerSecond;
+    double      itemsPerSecond;
+};
+
+bool startsWith(const char* str, const char* prefix, const char** value)
+{
+    const size_t prefixLength = strlen(prefix);
+    if (strncmp(str, prefix, prefixLength) != 0) return false;
+    *value = str + prefixLength;
+    return true;
+}
+
+bool parseOptions(int argc, char* argv[], Options& options)
+{
+    options.context.dataDirectory = WS_BENCHMARKS_DATA_DIR;
+    for (int i = 1; i < argc; i++)
+    {
+        const char* value = nullptr;
+        if (startsWith(argv[i], "--filter=", &value))
+            options.filter = value;
+        else if (startsWith(argv[i], "--json=", &value))
+            options.jsonPath = value;
+        else if (startsWith(argv[i], "--min-time=", &value))
+            options.minTime = atof(value);
+        else if (startsWith(argv[i], "--data-dir=", &value))
+            options.context.dataDirectory = value;
+        else
+        {
+            fmt::print("Usage: {} [--filter=text] [--min-time=seconds] [--data-dir=path] "
+                       "[--json=file]\n",
+                       argv[0]);
+            return false;
+        }
+    }
+    return true;
+}
+
+Result runBenchmark(const Benchmark& benchmark, const Iteration& iteration, const Options& options)
+{
+    using Clock = std::chrono::steady_clock;
+
+    // Warm up the caches and let the iteration allocate what it needs
+    const Work work = iteration();
+
+    Vector<double> durations;
+    double         totalTime = 0.0;
+    while (durations.size() < options.minIterations || totalTime < options.minTime)
+    {
+        const Clock::time_point start = Clock::now();
+        doNotOptimize(iteration());
+        const std::chrono::duration<double> duration = Clock::now() - start;
+        durations.push_back(duration.count());
+        totalTime += duration.count();
+    }
+    std::sort(durations.begin(), durations.end());
+
+    Result result;
+    result.name           = benchmark.name;
+    result.itemsName      = benchmark.itemsName;
+    result.iterations     = durations.size();
+    result.medianSeconds  = durations[durations.size() / 2];
+    result.minSeconds     = durations.front();
+    result.bytesPerSecond = double(work.bytes) / result.medianSeconds;
+    result.itemsPerSecond = double(work.items) / result.medianSeconds;
+    return result;
+}
+
+std::string toJsonString(const std::string& str)
+{
+    std::string escaped = "\"";
+    for (char c : str)
+    {
+        if (c == '"' || c == '\\') escaped += '\\';
+        escaped += c;
+    }
+    return escaped + '"';
+}
+
+bool writeJson(const std::string& path, const Vector<Result>& results)
+{
+    FILE* file = path == "-" ? stdout : fopen(path.c_str(), "w");
+    if (!file) return false;
+#ifdef NDEBUG
+    const bool assertions = false;
+#else
+    const bool assertions = true;
+#endif
+    fmt::print(file, "{{\n  \"context\": {{ \"assertions\": {} }},\n  \"benchmarks\": [\n",
+               assertions ? "true" : "false");
+    for (size_t i = 0; i < results.size(); i++)
+    {
+        const Result& result = results[i];
+        fmt::print(file,
+                   "    {{ \"name\": {}, \"iterations\": {}, \"median_seconds\": {:.9g}, "
+                   "\"min_seconds\": {:.9g}, \"bytes_per_second\": {:.6g}, "
+                   "\"items_per_second\": {:.6g}, \"items_name\": {} }}{}\n",
+                   toJsonString(result.name), result.iterations, result.medianSeconds,
+                   result.minSeconds, result.bytesPerSecond, result.itemsPerSecond,
+                   toJsonString(result.itemsName), i + 1 < results.size() ? "," : "");
+    }
+    fmt::print(file, "  ]\n}}\n");
+    if (file != stdout) fclose(file);
+    return true;
+}
+} // anonymous namespace
+
+int main(int argc, char* argv[])
+{
+    Options options;
+    if (!parseOptions(argc, argv, options)) return 1;
+
+    Vector<Benchmark> benchmarks;
+    registerBitStreamBenchmarks(benchmarks);
+    registerDecodersBenchmarks(benchmarks);
+
+    // Keep stdout clean for the JSON report
+    FILE* const textOutput = options.jsonPath == "-" ? stderr : stdout;
+#ifndef NDEBUG
+    fmt::print(textOutput, "Warning: assertions are enabled, timings are not representative.\n");
+#endif
+    fmt::print(textOutput, "{:<36} {:>12} {:>12} {:>20}\n", "Benchmark", "Median(ms)", "MB/s",
+               "Items/s");
+
+    Vector<Result> results;
+    for (const Benchmark& benchmark : benchmarks)
+    {
+        if (benchmark.name.find(options.filter) == std::string::npos) continue;
+        const Iteration iteration = benchmark.setup(options.context);
+        if (!iteration) {
+            fmt::print(textOutput, "{:<36} skipped, missing data ?\n", benchmark.name);
+            continue;
+        }
+        results.push_back(runBenchmark(benchmark, iteration, options));
+        const Result& result = results.back();
+        fmt::print(textOutput, "{:<36} {:>12.3f} {:>12.1f} {:>14.0f} {}/s\n", result.name,
+                   result.medianSeconds * 1000.0, result.bytesPerSecond / 1e6,
+                   result.itemsPerSecond, result.itemsName);
+    }
+
+    if (!options.jsonPath.empty() && !writeJson(options.jsonPath, results)) {
+        fmt::print(stderr, "Could not write the JSON report to {}\n", options.jsonPath);
+        return 1;
+    }
+    return 0;
+}
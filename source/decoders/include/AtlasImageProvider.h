@@ -0,0 +1,236 @@
+/**@file AtlasImageProvider.h
+ * Implements an image provider packing the images in texture atlases
+ */
+#pragma once
+
+#include <Vector.h>
+#include <algorithm>
+#include <assert.h>
+#include "ImageView.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief An image provider that packs the images in a few big pages, such as texture atlases.
+ *
+ * Instead of allocating a buffer for each image, images are placed in pages of a fixed size
+ * using a skyline bottom-left packer. The returned ImageViews point into the pages, so their
+ * stride is the width of the page. Each page can then be uploaded as a single texture, with the
+ * UV rectangles of the images given by @ref getUVRect.
+ *
+ * Images bigger than a page get their own page, of their exact size.
+ * Pages are zero initialized, and the views stay valid as long as the provider exists.
+ * @test{Decoders,AtlasImageProvider}
+ */
+template<class Color>
+class AtlasImageProvider : public IImageProvider<Color>
+{
+public:
+    /// Where an image was placed
+    struct Placement
+    {
+        size_t page;   ///< Index of the page containing the image
+        size_t x;      ///< Column of the first pixel of the image in the page
+        size_t y;      ///< Row of the first pixel of the image in the page
+        size_t width;  ///< Width of the image
+        size_t height; ///< Height of the image
+    };
+
+    /// Normalized texture coordinates of an image in its page
+    struct UVRect
+    {
+        float u0, v0; ///< Top left corner
+        float u1, v1; ///< Bottom right corner, excluded
+    };
+
+    /// Creates an empty atlas, pages are allocated on demand
+    AtlasImageProvider(size_t _pageWidth = 2048, size_t _pageHeight = 2048)
+        : pageWidth(_pageWidth), pageHeight(_pageHeight)
+    {
+        assert(pageWidth && pageHeight);
+    }
+
+    /// Places a new image in the first page that can hold it, or in a new page
+    ImageView<Color> getNewImage(size_t width, size_t height) override
+    {
+        if (!width || !height) return {};
+        Placement placement{0, 0, 0, width, height};
+        if (width > pageWidth || height > pageHeight) {
+            // Do not waste a whole page, and do not use it for other images
+            placement.page = addPage(width, height);
+            pages[placement.page].skyline.front().y = height;
+        }
+        else
+        {
+            for (; placement.page < pages.size(); placement.page++)
+            {
+                if (pages[placement.page].insert(width, height, placement.x, placement.y)) break;
+            }
+            if (placement.page == pages.size()) {
+                addPage(pageWidth, pageHeight);
+                const bool inserted = pages.back().insert(width, height, placement.x, placement.y);
+                assert(inserted);
+                (void)inserted;
+            }
+        }
+        placements.push_back(placement);
+        return getImage(placements.size() - 1);
+    }
+
+    /// @return The number of images allocated
+    size_t getImagesNumber() const { return placements.size(); }
+    /// @return The placement of the imageIndex-th image allocated
+    const Placement& getPlacement(size_t imageIndex) const { return placements[imageIndex]; }
+
+    /// @return An ImageView of the imageIndex-th image allocated, pointing into its page
+    ImageView<Color> getImage(size_t imageIndex)
+    {
+        const Placement& placement = placements[imageIndex];
+        return getPage(placement.page)
+            .subView(placement.x, placement.y, placement.width, placement.height);
+    }
+    /// @overload ImageView<const Color> getImage(size_t) const
+    ImageView<const Color> getImage(size_t imageIndex) const
+    {
+        const Placement& placement = placements[imageIndex];
+        return getPage(placement.page)
+            .subView(placement.x, placement.y, placement.width, placement.height);
+    }
+
+    /// @return The texture coordinates of the imageIndex-th image in its page
+    UVRect getUVRect(size_t imageIndex) const
+    {
+        const Placement& placement = placements[imageIndex];
+        const Page&      page      = pages[placement.page];
+        return {float(placement.x) / float(page.width), float(placement.y) / float(page.height),
+                float(placement.x + placement.width) / float(page.width),
+                float(placement.y + placement.height) / float(page.height)};
+    }
+
+    /// @return The number of pages allocated
+    size_t getPagesNumber() const { return pages.size(); }
+
+    /// @return An ImageView of a whole page
+    ImageView<Color> getPage(size_t pageIndex)
+    {
+        Page& page = pages[pageIndex];
+        return {page.pixels.data(), page.width, page.height, page.width};
+    }
+    /// @overload ImageView<const Color> getPage(size_t) const
+    ImageView<const Color> getPage(size_t pageIndex) const
+    {
+        const Page& page = pages[pageIndex];
+        return {page.pixels.data(), page.width, page.height, page.width};
+    }
+
+    size_t getPageWidth() const { return pageWidth; }
+    size_t getPageHeight() const { return pageHeight; }
+
+private:
+    /// A segment of the top of the used space of a page
+    struct SkylineNode
+    {
+        size_t x;     ///< First column of the segment
+        size_t y;     ///< Rows above y are used
+        size_t width; ///< Number of columns of the segment
+    };
+
+    struct Page
+    {
+        size_t              width;
+        size_t              height;
+        Vector<Color>       pixels;
+        Vector<SkylineNode> skyline; ///< Segments ordered by x, covering the whole width
+
+        Page(size_t _width, size_t _height)
+            : width(_width), height(_height), pixels(_width * _height), skyline{{0, 0, _width}}
+        {
+        }
+
+        /**Finds the lowest position where the rectangle fits, the leftmost one in case of ties.
+         * @return true if the rectangle was placed, false if the page is full
+         */
+        bool insert(size_t rectWidth, size_t rectHeight, size_t& outX, size_t& outY)
+        {
+            size_t bestNode = skyline.size();
+            size_t bestY    = height;
+            for (size_t node = 0; node < skyline.size(); node++)
+            {
+                size_t y;
+                if (fits(node, rectWidth, rectHeight, y) && y < bestY) {
+                    bestNode = node;
+                    bestY    = y;
+                }
+            }
+            if (bestNode == skyline.size()) return false;
+
+            outX = skyline[bestNode].x;
+            outY = bestY;
+            addSkylineLevel(bestNode, outX, bestY + rectHeight, rectWidth);
+            return true;
+        }
+
+        /// Checks if a rectangle fits at the left of a node, and gives the row it would start at
+        bool fits(size_t node, size_t rectWidth, size_t rectHeight, size_t& outY) const
+        {
+            const size_t x = skyline[node].x;
+            if (x + rectWidth > width) return false;
+            outY                  = 0;
+            size_t remainingWidth = rectWidth;
+            for (; remainingWidth > 0; node++)
+            {
+                outY = std::max(outY, skyline[node].y);
+                if (outY + rectHeight > height) return false;
+                remainingWidth -= std::min(remainingWidth, skyline[node].width);
+            }
+            return true;
+        }
+
+        /// Raises the skyline over the columns [x, x + levelWidth) to y
+        void addSkylineLevel(size_t node, size_t x, size_t y, size_t levelWidth)
+        {
+            skyline.insert(skyline.begin() + ptrdiff_t(node), SkylineNode{x, y, levelWidth});
+
+            // Shrink or remove the nodes that are now below the new one
+            const size_t levelEnd = x + levelWidth;
+            const size_t next     = node + 1;
+            while (next < skyline.size() && skyline[next].x < levelEnd)
+            {
+                SkylineNode& covered    = skyline[next];
+                const size_t coveredEnd = covered.x + covered.width;
+                if (coveredEnd <= levelEnd) {
+                    skyline.erase(skyline.begin() + ptrdiff_t(next));
+                }
+                else
+                {
+                    covered.x     = levelEnd;
+                    covered.width = coveredEnd - levelEnd;
+                }
+            }
+
+            // Merge the neighbours at the same level
+            for (size_t i = 0; i + 1 < skyline.size();)
+            {
+                if (skyline[i].y == skyline[i + 1].y) {
+                    skyline[i].width += skyline[i + 1].width;
+                    skyline.erase(skyline.begin() + ptrdiff_t(i + 1));
+                }
+                else
+                    i++;
+            }
+        }
+    };
+
+    size_t addPage(size_t width, size_t height)
+    {
+        pages.emplace_back(width, height);
+        return pages.size() - 1;
+    }
+
+    size_t            pageWidth;
+    size_t            pageHeight;
+    Vector<Page>      pages;
+    Vector<Placement> placements;
+};
+} // namespace WorldStone
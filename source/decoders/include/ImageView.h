@@ -5,6 +5,7 @@
 
 #include <Platform.h>
 #include <Vector.h>
+#include <algorithm>
 #include <string.h> // memcpy & memset
 
 namespace WorldStone
@@ -20,6 +21,7 @@ namespace WorldStone
  *       ImageView maps on a mutable buffer unless the template parameter is const.
  *       What this means is that a gsl::span is the equivalent of ImageView<uint8_t>
  *       while a std::view would be ImageView<const uint8_t> for example.
+ * @test{Decoders,ImageView_CopyFillBlit}
  */
 template<class Color>
 struct ImageView
@@ -77,6 +79,11 @@ struct ImageView
      */
     void copyTo(ImageView destination) const
     {
+        // Contiguous images are copied at once, the rows being one after the other
+        if (stride == width && destination.stride == width) {
+            memcpy(destination.buffer, buffer, width * height * sizeof(Color));
+            return;
+        }
         for (size_t y = 0; y < height; y++)
         {
             memcpy(destination.buffer + y * destination.stride, buffer + y * stride,
@@ -94,13 +101,17 @@ struct ImageView
      */
     void fill(size_t x, size_t y, size_t columns, size_t rows, Color colorValue)
     {
-        Color* lineStart = buffer + x + y * stride;
-        for (size_t row = 0; row < rows; ++row)
+        if (!rows) return;
+        Color* const firstLine = buffer + x + y * stride;
+        for (size_t column = 0; column < columns; column++)
+        {
+            firstLine[column] = colorValue;
+        }
+        // Copying the first line is faster than filling each pixel again
+        Color* lineStart = firstLine + stride;
+        for (size_t row = 1; row < rows; ++row)
         {
-            for (size_t column = 0; column < columns; column++)
-            {
-                lineStart[column] = colorValue;
-            }
+            memcpy(lineStart, firstLine, columns * sizeof(Color));
             lineStart += stride;
         }
     }
@@ -123,8 +134,19 @@ struct ImageView
     }
 };
 
+/**Copies the pixels of source that are not transparent over destination, eg: to compose sprites.
+ * @param source      The image to draw
+ * @param destination Must be at least as big as source. Only the pixels of source with a value
+ *                    different from transparentKey are written.
+ * @param transparentKey The value of the transparent pixels, 0 for the DC6/DCC sprites
+ * @note Uses SSE2 or AVX2 byte compares and blends when supported by the processor.
+ */
+void blitTransparent(ImageView<const uint8_t> source, ImageView<uint8_t> destination,
+                     uint8_t transparentKey = 0);
+
 /**An interface of a class that can provide images views.
  * One example would be to reuse the same texture to store multiple images.
+ * @see AtlasImageProvider, SimpleImageProvider, SlabImageProvider
  */
 template<class Color>
 class IImageProvider
@@ -132,10 +154,22 @@ class IImageProvider
 public:
     /// Returns an ImageView of dimensions width * height to be used by the consumer.
     virtual ImageView<Color> getNewImage(size_t width, size_t height) = 0;
+    /**Tells the provider how many images are about to be requested, so that it can preallocate.
+     * This is only a hint, the default implementation does nothing.
+     * @param nbImages Number of images that will be requested
+     * @param nbPixels Total number of pixels of those images
+     */
+    virtual void reserve(size_t nbImages, size_t nbPixels)
+    {
+        (void)nbImages;
+        (void)nbPixels;
+    }
     virtual ~IImageProvider() {}
 };
 
-/// A simple image provider that allocates a new buffer for each call to getNewImage()
+/**A simple image provider that allocates a new buffer for each call to getNewImage()
+ * @see SlabImageProvider to allocate less and keep the images close to each other in memory
+ */
 template<class Color>
 class SimpleImageProvider : public IImageProvider<Color>
 {
@@ -161,6 +195,13 @@ public:
         return {images.back().buffer.data(), width, height, width};
     }
 
+    /// Reserves the list of images, the buffers are still allocated separately
+    void reserve(size_t nbImages, size_t) override
+    {
+        const size_t capacity = images.size() + nbImages;
+        if (capacity > images.capacity()) images.reserve(std::max(capacity, images.capacity() * 2));
+    }
+
     /// @return The number of images allocated
     size_t getImagesNumber() const { return images.size(); }
 
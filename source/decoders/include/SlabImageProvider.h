@@ -0,0 +1,106 @@
+/**@file SlabImageProvider.h
+ * Implements an image provider allocating the images from a few big buffers
+ */
+#pragma once
+
+#include <Vector.h>
+#include <algorithm>
+#include <memory>
+#include "ImageView.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief An image provider that bump-allocates the images in big contiguous buffers (slabs).
+ *
+ * Unlike @ref SimpleImageProvider which allocates a buffer per image, the images are placed one
+ * after the other in slabs. This results in much less allocations and keeps the frames close
+ * to each other in memory. Decoders call @ref reserve with the total size of the frames they are
+ * about to allocate, so that a direction usually fits in a single slab.
+ *
+ * Images are zero initialized, and the views stay valid as long as the provider exists.
+ * @test{Decoders,SlabImageProvider}
+ */
+template<class Color>
+class SlabImageProvider : public IImageProvider<Color>
+{
+    using Slab = Vector<Color>;
+
+public:
+    /**An image moved out of the provider by @ref moveImageBuffer.
+     * It shares the ownership of its slab, so it stays valid after the provider is destroyed.
+     */
+    struct ImageBuffer
+    {
+        std::shared_ptr<Slab> slab;  ///< The slab containing the image
+        ImageView<Color>      image; ///< Invalid if the image was already moved
+    };
+
+    /// @param _slabSize Minimum number of pixels of the slabs
+    explicit SlabImageProvider(size_t _slabSize = 1024 * 1024) : slabSize(_slabSize) {}
+
+    /// Allocates a new image of dimensions width * height from the current slab
+    ImageView<Color> getNewImage(size_t width, size_t height) override
+    {
+        if (!width || !height) return {};
+        const size_t nbPixels = width * height;
+        if (!currentSlab || currentSlab->size() - slabUsed < nbPixels) addSlab(nbPixels);
+
+        images.push_back({currentSlab, {currentSlab->data() + slabUsed, width, height, width}});
+        slabUsed += nbPixels;
+        return images.back().image;
+    }
+
+    /**Makes sure that the next images, up to nbPixels pixels in total, are allocated from the
+     * same slab, allocating it now if needed.
+     */
+    void reserve(size_t nbImages, size_t nbPixels) override
+    {
+        const size_t capacity = images.size() + nbImages;
+        if (capacity > images.capacity()) images.reserve(std::max(capacity, images.capacity() * 2));
+        if (nbPixels && (!currentSlab || currentSlab->size() - slabUsed < nbPixels))
+            addSlab(nbPixels);
+    }
+
+    /// @return The number of images allocated
+    size_t getImagesNumber() const { return images.size(); }
+
+    /// @return An ImageView of the imageIndex-th image allocated.
+    ImageView<Color> getImage(size_t imageIndex) { return images[imageIndex].image; }
+    /// @overload ImageView<const Color> getImage(size_t) const
+    ImageView<const Color> getImage(size_t imageIndex) const { return images[imageIndex].image; }
+
+    /**Move an image out of the provider.
+     * @param imageIndex The index of the image to return, in order of allocation.
+     * @note  Unlike @ref SimpleImageProvider, the whole slab is kept alive until all the buffers
+     *        referencing it and the provider are destroyed.
+     *        Further calls to getImage(imageIndex) will return an invalid ImageView.
+     */
+    ImageBuffer moveImageBuffer(size_t imageIndex)
+    {
+        ImageBuffer& buffer = images[imageIndex];
+        ImageBuffer  moved  = std::move(buffer);
+        buffer              = {};
+        return moved;
+    }
+
+    /// @return The number of slabs allocated
+    size_t getSlabsNumber() const { return slabsNumber; }
+
+private:
+    void addSlab(size_t minSize)
+    {
+        currentSlab = std::make_shared<Slab>(std::max(slabSize, minSize));
+        slabUsed    = 0;
+        slabsNumber++;
+    }
+
+    size_t                slabSize;
+    std::shared_ptr<Slab> currentSlab;     ///< The slab in which new images are allocated
+    size_t                slabUsed    = 0; ///< Number of pixels of currentSlab already used
+    size_t                slabsNumber = 0;
+    /// The older slabs are kept alive by the images referencing them
+    Vector<ImageBuffer> images;
+};
+} // namespace WorldStone
@@ -0,0 +1,120 @@
+/**@file SpriteCache.h
+ * Implements a cache of decoded sprites
+ */
+#pragma once
+
+#include <Archive.h>
+#include <Stream.h>
+#include <Vector.h>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include "ImageView.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief A thread-safe cache of the decoded frames of sprite directions.
+ *
+ * Entries are identified by the archive, the path of the file and the direction, and are evicted
+ * in least recently used order when the memory used by the frames exceeds a budget.
+ * If multiple threads request the same entry while it is being decoded, only one decode happens
+ * and all of them get its result.
+ *
+ * Frames are shared with the users of the cache, so an evicted entry stays valid as long as
+ * someone holds it. It is however not accounted in the budget anymore.
+ * @test{Decoders,SpriteCache}
+ */
+class SpriteCache
+{
+public:
+    /// Identifies a direction of a sprite file
+    struct Key
+    {
+        /// The path is normalized, so that the case and separators used do not matter
+        Key(const Archive* sourceArchive, const std::string& filePath, uint32_t directionIndex);
+
+        const Archive* archive;   ///< The archive containing the file, nullptr if none
+        std::string    path;      ///< The normalized path of the file, in the archive if any
+        uint32_t       direction; ///< The index of the direction in the file
+
+        bool operator==(const Key& rhs) const
+        {
+            return archive == rhs.archive && direction == rhs.direction && path == rhs.path;
+        }
+    };
+
+    /// The decoded frames of a direction
+    struct Frames
+    {
+        Vector<ImageView<const uint8_t>> images;  ///< The frames in the order of the file
+        SimpleImageProvider<uint8_t>     storage; ///< Owns the memory of the images
+    };
+    using FramesPtr = std::shared_ptr<const Frames>;
+    /// Decodes the frames of a direction, returns nullptr on failure
+    using Loader = std::function<FramesPtr()>;
+
+    /// @param budgetInBytes Maximum memory used by the frames before evicting entries
+    explicit SpriteCache(size_t budgetInBytes);
+    SpriteCache(const SpriteCache&) = delete;
+    SpriteCache& operator=(const SpriteCache&) = delete;
+
+    /**Returns the frames of the given key, decoding them if needed.
+     * @param key    The direction to get
+     * @param loader Called from the calling thread if the entry is not cached nor being decoded
+     * @return The frames, or nullptr if the loader failed. Failures are not cached.
+     * @note If the loader throws, the exception is rethrown to all the callers waiting for it.
+     */
+    FramesPtr get(const Key& key, const Loader& loader);
+
+    /// Decodes a direction of a DCC file, meant to be called by a @ref Loader
+    static FramesPtr decodeDCCDirection(StreamPtr&& stream, uint32_t direction);
+    /// Decodes a direction of a DC6 file, meant to be called by a @ref Loader
+    static FramesPtr decodeDC6Direction(StreamPtr&& stream, uint32_t direction);
+
+    /// Removes all the entries that are not being decoded
+    void clear();
+
+    /// Changes the budget, evicting entries if needed
+    void setBudget(size_t budgetInBytes);
+    size_t getBudget() const;
+    /// @return The memory used by the frames of the cached entries, in bytes
+    size_t getMemoryUsage() const;
+    /// @return The number of entries, including the ones being decoded
+    size_t getEntriesCount() const;
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const;
+    };
+    struct Entry
+    {
+        std::shared_future<FramesPtr> frames;
+        std::list<Key>::iterator      lruPosition;
+        uint64_t                      loadId;              ///< Identifies the decode in flight
+        size_t                        sizeInBytes = 0;
+        bool                          loaded      = false; ///< Pending entries can't be evicted
+    };
+    using EntriesMap = std::unordered_map<Key, Entry, KeyHash>;
+
+    /// Called once the loader returned, to insert or discard the result
+    void finishLoading(const Key& key, uint64_t loadId, const FramesPtr& frames);
+    /// Must be called with the mutex locked
+    void evictOverBudget();
+    /// Must be called with the mutex locked
+    void erase(EntriesMap::iterator entryIt);
+
+    mutable std::mutex mutex;
+    EntriesMap         entries;
+    std::list<Key>     lruList; ///< Keys of the entries, the most recently used first
+    size_t             budget;
+    size_t             memoryUsage = 0;
+    uint64_t           nextLoadId  = 0;
+};
+} // namespace WorldStone
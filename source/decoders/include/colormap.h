@@ -0,0 +1,66 @@
+/**
+ * @file colormap.h
+ * @author Lectem
+ */
+#pragma once
+
+#include <assert.h>
+#include <stdint.h>
+#include <Stream.h>
+#include <Vector.h>
+#include "ImageView.h"
+
+namespace WorldStone
+{
+/**
+ * @brief Helper to load Diablo 2 colormaps (.dat format), also known as palette shifts.
+ *
+ * A colormap is a list of variants, each variant being a 256 entries table mapping a palette
+ * index to another one of the same palette.
+ * They are used to create color variations of a same image without any additional sprite, for
+ * example the 21 tints of the items palettes, or the light levels of the act colormaps.
+ *
+ * @test{Decoders,ColorMap}
+ */
+class ColorMap
+{
+public:
+    static const size_t variantSize = 256; ///< Number of entries of a variant
+
+    void decode(const char* filename);
+    /// Reads all the variants, from the current position of the file to its end
+    void decode(IStream* file);
+    bool isValid() const { return valid; }
+
+    /// @return The number of variants (tables) of the colormap
+    size_t getVariantsCount() const { return variantsCount; }
+    /// @return The @ref variantSize entries of the given variant
+    const uint8_t* getVariant(size_t variant) const
+    {
+        assert(variant < variantsCount);
+        return tables.data() + variant * variantSize;
+    }
+
+private:
+    bool   valid         = false;
+    size_t variantsCount = 0;
+    /// All the variants, followed by a few bytes of padding for the vectorized remapping
+    Vector<uint8_t> tables;
+};
+
+/**Replace the indices of an image by the ones of a colormap variant.
+ * @param source      The original indices, typically the output of a decoder
+ * @param destination Must be at least as big as source, may be the same image as source
+ * @param colorMap    A valid colormap
+ * @param variant     Index of the table to use, must be less than colorMap.getVariantsCount()
+ * @note Uses AVX2 gathers when supported by the processor.
+ */
+void remap(ImageView<const uint8_t> source, ImageView<uint8_t> destination,
+           const ColorMap& colorMap, size_t variant);
+
+/// Same as @ref remap, but modifies the image in place
+inline void remap(ImageView<uint8_t> image, const ColorMap& colorMap, size_t variant)
+{
+    remap(image, image, colorMap, variant);
+}
+} // namespace WorldStone
@@ -5,10 +5,13 @@
 #include <memory>
 #include <type_traits>
 #include <vector>
+#include "ImageView.h"
 #include "palette.h"
 
 namespace WorldStone
 {
+class ThreadPool;
+
 /**
  * @brief Decoder for the DC6 image format
  *
@@ -19,6 +22,8 @@ namespace WorldStone
  *
  * This format is mostly used for menu, items but also for some monsters (eg:Mephisto)
  * This is an update of diablo 1 Cel format
+ * @test{Decoders,DC6}
+ * @test{Decoders,DC6_DecompressAll}
  */
 class DC6
 {
@@ -50,8 +55,17 @@ protected:
     Header                   header;
     std::vector<uint32_t>    framePointers;
     std::vector<FrameHeader> frameHeaders;
+    /// Content of the whole file, read only if the stream can not give a view of it
+    std::vector<uint8_t> fileBuffer;
+    const uint8_t*       fileData = nullptr; ///< Points to the stream view or to fileBuffer
+    size_t               fileSize = 0;
 
+    /**Gets the content of the file with a single read, then parses all the headers from memory.
+     * The content is kept to decode the frames without accessing the stream anymore.
+     */
     bool extractHeaders();
+    /// Returns the encoded data of a frame, nullptr if it is outside of the file
+    const uint8_t* getFrameData(size_t frameNumber) const;
 
 public:
     /**Start decoding the stream and preparing data.
@@ -75,9 +89,24 @@ public:
      */
     std::vector<uint8_t> decompressFrame(size_t frameNumber) const;
     /**Same as @ref decompressFrame but will output the data in a given buffer
-     * @warning: asserts on failure
+     * @param frameNumber The frame number in the file
+     * @param data        Buffer of at least width * height bytes. Transparent pixels are left
+     *                    untouched, so it is usually zero initialized.
+     * @return true on success, false if the frame could not be read or its data is invalid
+     * @note As the file content is read by @ref initDecoder, frames can be decompressed
+     *       concurrently.
+     */
+    bool decompressFrameIn(size_t frameNumber, uint8_t* data) const;
+
+    /**Decompresses all the frames of the file, in parallel.
+     * @param imgProvider Provides the images of the frames. They are allocated in the order of the
+     *                    file, from the calling thread.
+     * @param threadPool  The pool used to decode the frames concurrently.
+     * @return true on success, false if any frame could not be read or its data is invalid
+     *
+     * Each frame is decoded directly in its image. Transparent pixels are set to 0.
      */
-    void decompressFrameIn(size_t frameNumber, uint8_t* data) const;
+    bool decompressAll(IImageProvider<uint8_t>& imgProvider, ThreadPool& threadPool) const;
 
     void exportToPPM(const char* ppmFilenameBase, const Palette& palette) const;
 };
@@ -6,6 +6,8 @@
 #include <stdint.h>
 #include <FileStream.h>
 #include <Vector.h>
+#include <array>
+#include <functional>
 #include <memory>
 #include <type_traits>
 #include "AABB.h"
@@ -14,6 +16,8 @@
 
 namespace WorldStone
 {
+class ThreadPool;
+
 /**
  * @brief Decoder for the DCC image format
  *
@@ -28,6 +32,13 @@ namespace WorldStone
  * @test{Decoders,DCC_CRHDBRVDTHTH}
  * @test{Decoders,DCC_BloodSmall01}
  * @test{Decoders,DCC_HZTRLITA1HTH}
+ * @test{Decoders,DCC_AllDirections}
+ * @test{Decoders,DCC_ParallelFrames}
+ * @test{Decoders,DCC_DirectionDecoder}
+ * @test{Decoders,DCC_DirectionHeaders}
+ * @test{Decoders,DCC_DecodeContext}
+ * @test{Decoders,DCC_BlockDictionary}
+ * @test{Decoders,DCC_MemoryMapped}
  */
 class DCC
 {
@@ -118,6 +129,88 @@ public:
     static constexpr unsigned bitsWidthTable[16] = {0,  1,  2,  4,  6,  8,  10, 12,
                                                     14, 16, 20, 24, 26, 28, 30, 32};
 
+    /**
+     * @brief Memory reused from one decoding to another, to avoid allocations.
+     *
+     * Decoding a direction uses temporary buffers, which are kept by the context afterwards.
+     * Once they are big enough, decoding other directions, of the same file or not, with the same
+     * context does not allocate memory besides the frames images.
+     * @note A context can only be used by one decoding at a time.
+     * @test{Decoders,DCC_DecodeContext}
+     */
+    class DecodeContext
+    {
+    public:
+        DecodeContext();
+        ~DecodeContext();
+        DecodeContext(DecodeContext&&);
+        DecodeContext& operator=(DecodeContext&&);
+
+        /// Frees the memory kept by the context
+        void releaseMemory();
+
+    private:
+        friend class DCC;
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+    };
+
+    /**
+     * @brief The frames of a direction stored as unique blocks of 4x4 pixels, for tiled rendering.
+     *
+     * The direction is split in blocks aligned on the top left corner of its extents, which is
+     * also how the DCC format splits the frames in cells. Identical blocks are stored only once,
+     * and each frame is a list of references to them. Blocks that are fully transparent (only
+     * 0 values) are omitted, and the pixels of a block that are outside of the frame are 0.
+     *
+     * Animations reuse most cells from one frame to the next, so this takes a lot less memory
+     * than the frames images.
+     * @test{Decoders,DCC_BlockDictionary}
+     */
+    struct BlockDictionary
+    {
+        static constexpr size_t blockSize = 4; ///< Width and height of a block
+        /// The pixels of a block, row by row
+        using Block = std::array<uint8_t, blockSize * blockSize>;
+
+        /// A block of a frame
+        struct BlockRef
+        {
+            uint16_t cellX;      ///< Column of the block in the direction, in blocks
+            uint16_t cellY;      ///< Row of the block in the direction, in blocks
+            uint32_t blockIndex; ///< Index of the block in @ref blocks
+        };
+
+        Vector<Block>    blocks;    ///< The unique blocks of all the frames
+        Vector<BlockRef> blockRefs; ///< The blocks of all the frames, in order
+        /// Index in @ref blockRefs of the first block of each frame, plus the total number of refs
+        Vector<size_t> framesFirstBlockRef;
+
+        /// Returns the number of frames of the direction
+        size_t getFramesNumber() const
+        {
+            return framesFirstBlockRef.empty() ? 0 : framesFirstBlockRef.size() - 1;
+        }
+        /// Returns the first block of a frame, use @ref frameEnd to iterate over its blocks
+        const BlockRef* frameBegin(size_t frameIndex) const
+        {
+            return blockRefs.data() + framesFirstBlockRef[frameIndex];
+        }
+        /// Returns the end of the blocks of a frame
+        const BlockRef* frameEnd(size_t frameIndex) const
+        {
+            return blockRefs.data() + framesFirstBlockRef[frameIndex + 1];
+        }
+
+        /// Removes all the blocks and frames, but keeps the memory allocated
+        void clear()
+        {
+            blocks.clear();
+            blockRefs.clear();
+            framesFirstBlockRef.clear();
+        }
+    };
+
 protected:
     StreamPtr stream = nullptr;
     Header    header;
@@ -129,10 +222,19 @@ protected:
     Vector<uint32_t> directionsOffsets;
     Vector<uint32_t> framePointers;
 
-    size_t getDirectionSize(uint32_t dirIndex);
+    size_t getDirectionSize(uint32_t dirIndex) const;
+
+    /**Get the data at the given range of the stream, padded for use with a BitStreamView.
+     * @return A view of the stream data if available, or the data copied into fallbackBuffer.
+     *         nullptr on failure.
+     */
+    const uint8_t* getEncodedData(size_t offset, size_t size, Vector<uint8_t>& fallbackBuffer);
 
     bool extractHeaderAndOffsets();
 
+    bool readDirection(Direction& outDir, uint32_t dirIndex, IImageProvider<uint8_t>& imgProvider,
+                       DecodeContext& context, ThreadPool* threadPool);
+
 public:
     /**Start decoding the stream and preparing data.
      * @return true on success
@@ -156,6 +258,107 @@ public:
      * using the image provider will be in the order of the file.
      */
     bool readDirection(Direction& outDir, uint32_t dirIndex, IImageProvider<uint8_t>& imgProvider);
+    /**Same as @ref readDirection, but the frames are decoded concurrently using threadPool.
+     * The images are still allocated in order from the calling thread, and the result is the same.
+     */
+    bool readDirection(Direction& outDir, uint32_t dirIndex, IImageProvider<uint8_t>& imgProvider,
+                       ThreadPool& threadPool);
+    /**Same as @ref readDirection, but reuses the memory of context instead of allocating it.
+     * Reusing outDir and context for multiple directions avoids all allocations, except the
+     * ones of imgProvider.
+     */
+    bool readDirection(Direction& outDir, uint32_t dirIndex, IImageProvider<uint8_t>& imgProvider,
+                       DecodeContext& context);
+
+    /**Decodes a direction of the file as a dictionary of blocks instead of images.
+     * @param outDir    Will hold the Direction information obtained during decoding.
+     * @param dirIndex  The number of the direction in the file.
+     * @param outBlocks Cleared, then receives the blocks of the frames. See @ref BlockDictionary.
+     * @return true on success
+     *
+     * The position of a block in a frame is (blockSize * cellX, blockSize * cellY) minus the
+     * position of the frame in the direction, as given by the extents of both.
+     */
+    bool readDirection(Direction& outDir, uint32_t dirIndex, BlockDictionary& outBlocks);
+    /// Same as the above @ref readDirection, but reuses the memory of context
+    bool readDirection(Direction& outDir, uint32_t dirIndex, BlockDictionary& outBlocks,
+                       DecodeContext& context);
+
+    /**Reads the headers of a direction, without decoding its frames.
+     * @param outDir   Will hold the headers of the direction and the frames, and their extents.
+     * @param dirIndex The number of the direction in the file.
+     * @return true on success
+     *
+     * Only the beginning of the direction is read, which makes it much faster than
+     * @ref readDirection when only the dimensions of the frames are needed.
+     */
+    bool readDirectionHeaders(Direction& outDir, uint32_t dirIndex);
+
+    /// Returns the image provider to use for the direction dirIndex, see @ref readAllDirections.
+    using ImageProviderFactory = std::function<IImageProvider<uint8_t>&(uint32_t dirIndex)>;
+
+    /**Decodes all the directions of the file, in parallel.
+     * @param outDirections   Resized to the number of directions, holds the decoded Directions.
+     * @param threadPool      The pool used to decode the directions concurrently.
+     * @param providerFactory Called once per direction, in order, from the calling thread.
+     *                        Each direction must be given its own image provider.
+     * @return true on success
+     *
+     * The file data of all directions is read once, then each direction is decoded by a different
+     * task, which also decodes its frames concurrently. The result is the same as calling
+     * @ref readDirection for each direction.
+     */
+    bool readAllDirections(Vector<Direction>& outDirections, ThreadPool& threadPool,
+                           const ImageProviderFactory& providerFactory);
+
+    /**
+     * @brief Decodes the frames of a direction one at a time, for example for animation playback.
+     *
+     * Unlike @ref readDirection, no image is allocated for the frames: each frame is written to
+     * the buffer given to @ref decodeNextFrame. Only a buffer of the size of the direction is kept
+     * to reconstruct the frames, as they depend on the previous ones.
+     * @note The pixels of the frames follow the information needed by all the frames in the file,
+     *       so @ref initDecoder still has to process the whole direction before the first frame.
+     *       This is however much faster than decoding the pixels.
+     * @warning The DCC must outlive the decoder, as it may use the data of its stream directly.
+     * @test{Decoders,DCC_DirectionDecoder}
+     */
+    class DirectionDecoder
+    {
+    public:
+        DirectionDecoder();
+        ~DirectionDecoder();
+        DirectionDecoder(DirectionDecoder&&);
+        DirectionDecoder& operator=(DirectionDecoder&&);
+
+        /**Prepares the decoding of the frames of a direction.
+         * @param dcc      An initialized decoder of the file containing the direction.
+         * @param dirIndex The number of the direction in the file.
+         * @return true on success
+         */
+        bool initDecoder(DCC& dcc, uint32_t dirIndex);
+
+        /// Returns the Direction information, only valid after a successful @ref initDecoder
+        const Direction& getDirection() const;
+        /// Returns the index of the frame that the next call to @ref decodeNextFrame will decode
+        size_t getNextFrameIndex() const;
+        /// Returns false once all the frames were decoded, or if the decoder is not initialized
+        bool hasNextFrame() const;
+
+        /**Decodes the next frame of the direction.
+         * @param frameImage Receives the frame pixels. Must be at least as big as the frame,
+         *                   see @ref FrameHeader::extents.
+         * @return true on success, false if there is no frame left or frameImage is too small
+         */
+        bool decodeNextFrame(ImageView<uint8_t> frameImage);
+
+        /// Goes back to the first frame, so that animations can loop without reading the file
+        void rewind();
+
+    private:
+        struct Impl;
+        std::unique_ptr<Impl> impl;
+    };
 
     /// Returns the header of the file read by extractHeaderAndOffsets
     const Header& getHeader() const { return header; }
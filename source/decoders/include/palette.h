@@ -7,6 +7,7 @@
 #include <cstdint>
 #include <Stream.h>
 #include <array>
+#include "ImageView.h"
 
 namespace WorldStone
 {
@@ -15,8 +16,9 @@ namespace WorldStone
  *
  * Diablo II uses 256 colors palettes to render images.
  * Most of the time they are used in combination with colormaps to have different color variations
- * of a same image.
+ * of a same image, see @ref ColorMap.
  *
+ * @test{Decoders,Palette}
  */
 struct Palette
 {
@@ -28,11 +30,42 @@ struct Palette
     static const int colorCount = 256;
     std::array<Color, colorCount> colors;
 
+    /// One packed 32-bit color per palette index
+    using PackedColors = std::array<uint32_t, colorCount>;
+
     void decode(const char* filename);
     void decode(IStream* file);
     bool isValid() const { return valid; }
 
+    /**Recomputes the tables returned by @ref getRGBA32 and @ref getBGRA32.
+     * Already done by @ref decode, only needed if @ref colors is modified afterwards.
+     */
+    void updatePackedColors();
+
+    /**Colors packed in the R,G,B,A byte order.
+     * Alpha is 255 except for the index 0, which is the transparent color of the DC6/DCC sprites.
+     */
+    const PackedColors& getRGBA32() const { return rgba32; }
+    /// Same as @ref getRGBA32 but in the B,G,R,A byte order
+    const PackedColors& getBGRA32() const { return bgra32; }
+
+    /// Converts paletted pixels to RGBA32 pixels. @see expandIndexedColors
+    void expandIndexedToRGBA(ImageView<const uint8_t> source,
+                             ImageView<uint32_t>      destination) const;
+
 private:
-    bool valid = false;
+    bool         valid = false;
+    PackedColors rgba32;
+    PackedColors bgra32;
 };
+
+/**Converts indexed pixels to 32-bit colors using a lookup table.
+ * @param source      The indices, typically the output of a decoder
+ * @param destination Must be at least as big as source, only source.width * source.height pixels
+ *                    are written.
+ * @param table       The color of each index, eg: @ref Palette::getRGBA32
+ * @note Uses AVX2 gathers when supported by the processor.
+ */
+void expandIndexedColors(ImageView<const uint8_t> source, ImageView<uint32_t> destination,
+                         const Palette::PackedColors& table);
 } // namespace WorldStone
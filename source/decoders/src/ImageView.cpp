@@ -0,0 +1,91 @@
+/**@file ImageView.cpp
+ * Implements the image operations that are not templates
+ */
+
+#include "ImageView.h"
+#include <assert.h>
+#include <CpuFeatures.h>
+
+#ifdef WS_X86
+#include <immintrin.h>
+#endif
+
+namespace WorldStone
+{
+
+namespace
+{
+using BlitRowFunction = void (*)(const uint8_t* source, uint8_t* destination, size_t count,
+                                 uint8_t transparentKey);
+
+void blitRowScalar(const uint8_t* source, uint8_t* destination, size_t count,
+                   uint8_t transparentKey)
+{
+    for (size_t i = 0; i < count; i++)
+    {
+        if (source[i] != transparentKey) destination[i] = source[i];
+    }
+}
+
+#ifdef WS_X86
+/// Selects 16 pixels at once, keeping the destination where the source is transparent
+WS_TARGET("sse2")
+void blitRowSSE2(const uint8_t* source, uint8_t* destination, size_t count,
+                 uint8_t transparentKey)
+{
+    const __m128i key = _mm_set1_epi8(char(transparentKey));
+    size_t        i   = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i* sourcePixels      = reinterpret_cast<const __m128i*>(source + i);
+        __m128i*       destinationPixels = reinterpret_cast<__m128i*>(destination + i);
+        const __m128i  src               = _mm_loadu_si128(sourcePixels);
+        const __m128i  dst               = _mm_loadu_si128(destinationPixels);
+        const __m128i  mask              = _mm_cmpeq_epi8(src, key); // Transparent pixels
+        _mm_storeu_si128(destinationPixels,
+                         _mm_or_si128(_mm_and_si128(mask, dst), _mm_andnot_si128(mask, src)));
+    }
+    blitRowScalar(source + i, destination + i, count - i, transparentKey);
+}
+
+/// Same as blitRowSSE2 with 32 pixels per iteration, using a single blend instruction
+WS_TARGET("avx2")
+void blitRowAVX2(const uint8_t* source, uint8_t* destination, size_t count,
+                 uint8_t transparentKey)
+{
+    const __m256i key = _mm256_set1_epi8(char(transparentKey));
+    size_t        i   = 0;
+    for (; i + 32 <= count; i += 32)
+    {
+        const __m256i* sourcePixels      = reinterpret_cast<const __m256i*>(source + i);
+        __m256i*       destinationPixels = reinterpret_cast<__m256i*>(destination + i);
+        const __m256i  src               = _mm256_loadu_si256(sourcePixels);
+        const __m256i  dst               = _mm256_loadu_si256(destinationPixels);
+        const __m256i  mask              = _mm256_cmpeq_epi8(src, key);
+        _mm256_storeu_si256(destinationPixels, _mm256_blendv_epi8(src, dst, mask));
+    }
+    blitRowSSE2(source + i, destination + i, count - i, transparentKey);
+}
+#endif
+
+BlitRowFunction selectBlitRow()
+{
+#ifdef WS_X86
+    if (CpuFeatures::get().avx2) return &blitRowAVX2;
+    if (CpuFeatures::get().sse2) return &blitRowSSE2;
+#endif
+    return &blitRowScalar;
+}
+} // anonymous namespace
+
+void blitTransparent(ImageView<const uint8_t> source, ImageView<uint8_t> destination,
+                     uint8_t transparentKey)
+{
+    assert(destination.width >= source.width && destination.height >= source.height);
+    static const BlitRowFunction blitRow = selectBlitRow();
+    for (size_t y = 0; y < source.height; y++)
+    {
+        blitRow(&source(0, y), &destination(0, y), source.width, transparentKey);
+    }
+}
+} // namespace WorldStone
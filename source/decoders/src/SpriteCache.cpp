@@ -0,0 +1,189 @@
+/**@file SpriteCache.cpp
+ * Implements a cache of decoded sprites
+ */
+
+#include "SpriteCache.h"
+#include <VirtualFileSystem.h>
+#include "dc6.h"
+#include "dcc.h"
+
+namespace WorldStone
+{
+
+SpriteCache::Key::Key(const Archive* sourceArchive, const std::string& filePath,
+                      uint32_t directionIndex)
+    : archive(sourceArchive),
+      path(VirtualFileSystem::normalizePath(filePath)),
+      direction(directionIndex)
+{
+}
+
+size_t SpriteCache::KeyHash::operator()(const Key& key) const
+{
+    size_t hash = std::hash<std::string>{}(key.path);
+    hash ^= std::hash<const Archive*>{}(key.archive) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    hash ^= std::hash<uint32_t>{}(key.direction) + 0x9e3779b9 + (hash << 6) + (hash >> 2);
+    return hash;
+}
+
+SpriteCache::SpriteCache(size_t budgetInBytes) : budget(budgetInBytes) {}
+
+SpriteCache::FramesPtr SpriteCache::get(const Key& key, const Loader& loader)
+{
+    std::promise<FramesPtr> promise;
+    uint64_t                loadId;
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        auto                         entryIt = entries.find(key);
+        if (entryIt != entries.end()) {
+            Entry& entry = entryIt->second;
+            lruList.splice(lruList.begin(), lruList, entry.lruPosition);
+            std::shared_future<FramesPtr> frames = entry.frames;
+            lock.unlock();
+            // Waits if the frames are being decoded by another thread
+            return frames.get();
+        }
+        loadId = nextLoadId++;
+        lruList.push_front(key);
+        Entry& entry      = entries[key];
+        entry.frames      = promise.get_future().share();
+        entry.lruPosition = lruList.begin();
+        entry.loadId      = loadId;
+    }
+
+    FramesPtr frames;
+    try
+    {
+        frames = loader();
+    }
+    catch (...)
+    {
+        finishLoading(key, loadId, nullptr);
+        promise.set_exception(std::current_exception());
+        throw;
+    }
+    finishLoading(key, loadId, frames);
+    promise.set_value(frames);
+    return frames;
+}
+
+void SpriteCache::finishLoading(const Key& key, uint64_t loadId, const FramesPtr& frames)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto                        entryIt = entries.find(key);
+    // The entry may have been removed by clear() and requested again in the meantime
+    if (entryIt == entries.end() || entryIt->second.loadId != loadId) return;
+    if (!frames) {
+        erase(entryIt);
+        return;
+    }
+    Entry& entry = entryIt->second;
+    for (const ImageView<const uint8_t>& image : frames->images)
+    {
+        entry.sizeInBytes += image.width * image.height;
+    }
+    entry.loaded = true;
+    memoryUsage += entry.sizeInBytes;
+    evictOverBudget();
+}
+
+void SpriteCache::evictOverBudget()
+{
+    auto lruIt = lruList.end();
+    while (memoryUsage > budget && lruIt != lruList.begin())
+    {
+        --lruIt;
+        auto entryIt = entries.find(*lruIt);
+        if (entryIt->second.loaded) {
+            // Move the iterator out of the list node that will be erased
+            ++lruIt;
+            erase(entryIt);
+        }
+    }
+}
+
+void SpriteCache::erase(EntriesMap::iterator entryIt)
+{
+    Entry& entry = entryIt->second;
+    if (entry.loaded) memoryUsage -= entry.sizeInBytes;
+    lruList.erase(entry.lruPosition);
+    entries.erase(entryIt);
+}
+
+void SpriteCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto entryIt = entries.begin(); entryIt != entries.end();)
+    {
+        auto nextIt = std::next(entryIt);
+        if (entryIt->second.loaded) erase(entryIt);
+        entryIt = nextIt;
+    }
+}
+
+void SpriteCache::setBudget(size_t budgetInBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    budget = budgetInBytes;
+    evictOverBudget();
+}
+
+size_t SpriteCache::getBudget() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return budget;
+}
+
+size_t SpriteCache::getMemoryUsage() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return memoryUsage;
+}
+
+size_t SpriteCache::getEntriesCount() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return entries.size();
+}
+
+SpriteCache::FramesPtr SpriteCache::decodeDCCDirection(StreamPtr&& stream, uint32_t direction)
+{
+    DCC dcc;
+    if (!dcc.initDecoder(std::move(stream)) || direction >= dcc.getHeader().directions) {
+        return nullptr;
+    }
+    auto           frames = std::make_shared<Frames>();
+    DCC::Direction dirData;
+    if (!dcc.readDirection(dirData, direction, frames->storage)) return nullptr;
+    for (size_t frame = 0; frame < frames->storage.getImagesNumber(); frame++)
+    {
+        frames->images.push_back(frames->storage.getImage(frame));
+    }
+    return frames;
+}
+
+SpriteCache::FramesPtr SpriteCache::decodeDC6Direction(StreamPtr&& stream, uint32_t direction)
+{
+    DC6 dc6;
+    if (!dc6.initDecoder(std::move(stream)) || direction >= dc6.getHeader().directions) {
+        return nullptr;
+    }
+    auto         frames       = std::make_shared<Frames>();
+    const size_t framesPerDir = dc6.getHeader().framesPerDir;
+    for (size_t frameInDir = 0; frameInDir < framesPerDir; frameInDir++)
+    {
+        const size_t            frame  = direction * framesPerDir + frameInDir;
+        const DC6::FrameHeader& header = dc6.getFrameHeaders()[frame];
+        if (header.width <= 0 || header.height <= 0) {
+            // Keep the frames order
+            frames->images.emplace_back();
+            continue;
+        }
+        ImageView<uint8_t> image =
+            frames->storage.getNewImage(size_t(header.width), size_t(header.height));
+        if (!dc6.decompressFrameIn(frame, image.buffer)) return nullptr;
+        frames->images.push_back(image);
+    }
+    return frames;
+}
+} // namespace WorldStone
@@ -0,0 +1,125 @@
+/**
+ * @file colormap.cpp
+ * @author Lectem
+ */
+
+#include "colormap.h"
+#include <CpuFeatures.h>
+#include <FileStream.h>
+
+#ifdef WS_X86
+#include <immintrin.h>
+#endif
+
+namespace WorldStone
+{
+
+namespace
+{
+/// The AVX2 version gathers 4 bytes starting at the looked up entry, and keeps only the first one
+constexpr size_t tablesPadding = 3;
+} // anonymous namespace
+
+void ColorMap::decode(const char* filename)
+{
+    FileStream str{filename};
+    decode(&str);
+}
+
+void ColorMap::decode(IStream* file)
+{
+    valid         = false;
+    variantsCount = 0;
+    tables.clear();
+    if (!file || !file->good()) return;
+
+    const long start = file->tell();
+    const long end   = file->size();
+    if (start < 0 || end <= start || size_t(end - start) % variantSize != 0) return;
+
+    const size_t tablesSize = size_t(end - start);
+    tables.resize(tablesSize + tablesPadding);
+    if (file->read(tables.data(), tablesSize) != tablesSize) {
+        tables.clear();
+        return;
+    }
+    variantsCount = tablesSize / variantSize;
+    valid         = true;
+}
+
+namespace
+{
+using RemapRowFunction = void (*)(const uint8_t* source, uint8_t* destination, size_t count,
+                                  const uint8_t* table);
+
+void remapRowScalar(const uint8_t* source, uint8_t* destination, size_t count,
+                    const uint8_t* table)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        destination[i + 0] = table[source[i + 0]];
+        destination[i + 1] = table[source[i + 1]];
+        destination[i + 2] = table[source[i + 2]];
+        destination[i + 3] = table[source[i + 3]];
+    }
+    for (; i < count; i++)
+    {
+        destination[i] = table[source[i]];
+    }
+}
+
+#ifdef WS_X86
+/**Remaps 16 pixels per iteration using two gathers of 8 entries.
+ * Gathers work on 32-bit elements, so we read 4 bytes at table + index (hence the padding of the
+ * tables) and pack the first byte of each element.
+ */
+WS_TARGET("avx2")
+void remapRowAVX2(const uint8_t* source, uint8_t* destination, size_t count,
+                  const uint8_t* table)
+{
+    const int*    tableAsInts = reinterpret_cast<const int*>(table);
+    const __m256i lowByteMask = _mm256_set1_epi32(0xFF);
+    size_t        i           = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i indices   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        const __m256i indicesLo = _mm256_cvtepu8_epi32(indices);
+        const __m256i indicesHi = _mm256_cvtepu8_epi32(_mm_srli_si128(indices, 8));
+        const __m256i valuesLo =
+            _mm256_and_si256(_mm256_i32gather_epi32(tableAsInts, indicesLo, 1), lowByteMask);
+        const __m256i valuesHi =
+            _mm256_and_si256(_mm256_i32gather_epi32(tableAsInts, indicesHi, 1), lowByteMask);
+        // packus works per 128-bit lane, reorder the 64-bit blocks to get back the pixels order
+        const __m256i words = _mm256_permute4x64_epi64(_mm256_packus_epi32(valuesLo, valuesHi),
+                                                       _MM_SHUFFLE(3, 1, 2, 0));
+        const __m128i bytes =
+            _mm_packus_epi16(_mm256_castsi256_si128(words), _mm256_extracti128_si256(words, 1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(destination + i), bytes);
+    }
+    remapRowScalar(source + i, destination + i, count - i, table);
+}
+#endif
+
+RemapRowFunction selectRemapRow()
+{
+#ifdef WS_X86
+    if (CpuFeatures::get().avx2) return &remapRowAVX2;
+#endif
+    return &remapRowScalar;
+}
+} // anonymous namespace
+
+void remap(ImageView<const uint8_t> source, ImageView<uint8_t> destination,
+           const ColorMap& colorMap, size_t variant)
+{
+    assert(colorMap.isValid());
+    assert(destination.width >= source.width && destination.height >= source.height);
+    static const RemapRowFunction remapRow = selectRemapRow();
+    const uint8_t*                table    = colorMap.getVariant(variant);
+    for (size_t y = 0; y < source.height; y++)
+    {
+        remapRow(&source(0, y), &destination(0, y), source.width, table);
+    }
+}
+} // namespace WorldStone
@@ -4,12 +4,14 @@
 
 #include "dc6.h"
 #include <FileStream.h>
+#include <ThreadPool.h>
+#include <assert.h>
+#include <string.h>
+#include <atomic>
 #include <fmt/format.h>
 #include "palette.h"
 #include "utils.h"
 
-// TODO : Remove asserts and replace with proper error handling
-
 namespace WorldStone
 {
 
@@ -25,86 +27,150 @@ bool DC6::initDecoder(StreamPtr&& streamPtr)
 
 bool DC6::extractHeaders()
 {
+    // Opening a file from an archive is slow if it has to seek for each frame header,
+    // so get the whole file at once instead.
+    const long streamSize = stream->size();
+    if (streamSize <= 0) return false;
+    fileSize = size_t(streamSize);
+    fileData = stream->tryGetContiguousView(0, fileSize);
+    if (!fileData) {
+        fileBuffer.resize(fileSize);
+        stream->seek(0, IStream::beg);
+        if (stream->read(fileBuffer.data(), fileSize) != fileSize) return false;
+        fileData = fileBuffer.data();
+    }
+
     static_assert(std::is_trivially_copyable<Header>(), "DC6::Header must be trivially copyable");
     static_assert(sizeof(Header) == 6 * sizeof(uint32_t), "DC6::Header struct needs to be packed");
-    stream->read(&header, sizeof(header));
-    if (stream->fail()) return false;
-
-    size_t framesNumber = header.directions * header.framesPerDir;
-    frameHeaders.resize(framesNumber);
+    if (fileSize < sizeof(header)) return false;
+    memcpy(&header, fileData, sizeof(header));
 
+    const size_t framesNumber = size_t(header.directions) * header.framesPerDir;
+    if ((fileSize - sizeof(header)) / sizeof(uint32_t) < framesNumber) return false;
     framePointers.resize(framesNumber);
-    stream->read(framePointers.data(), sizeof(uint32_t) * framesNumber);
-    if (stream->fail()) return false;
+    memcpy(framePointers.data(), fileData + sizeof(header), sizeof(uint32_t) * framesNumber);
 
+    frameHeaders.resize(framesNumber);
     for (size_t i = 0; i < framesNumber; ++i)
     {
         FrameHeader& frameHeader = frameHeaders[i];
-        stream->seek(framePointers[i], IStream::beg);
 
         static_assert(std::is_trivially_copyable<FrameHeader>(),
                       "DC6::FrameHeader must be trivially copyable");
         static_assert(sizeof(FrameHeader) == 8 * sizeof(uint32_t),
                       "DC6::FrameHeader struct needs to be packed");
-        stream->read(&frameHeader, sizeof(frameHeader));
-        if (stream->fail()) return false;
+        if (fileSize < sizeof(frameHeader) || framePointers[i] > fileSize - sizeof(frameHeader))
+            return false;
+        memcpy(&frameHeader, fileData + framePointers[i], sizeof(frameHeader));
     }
     return true;
 }
 
+const uint8_t* DC6::getFrameData(size_t frameNumber) const
+{
+    const FrameHeader& fHeader         = frameHeaders[frameNumber];
+    const size_t       frameDataOffset = framePointers[frameNumber] + sizeof(FrameHeader);
+    if (fHeader.length < 0 || static_cast<size_t>(fHeader.length) > fileSize - frameDataOffset)
+        return nullptr;
+    return fileData + frameDataOffset;
+}
+
 std::vector<uint8_t> DC6::decompressFrame(size_t frameNumber) const
 {
     const FrameHeader& fHeader = frameHeaders[frameNumber];
+    // Negative dimensions would be converted to huge sizes
+    if (fHeader.width <= 0 || fHeader.height <= 0) return {};
     // Allocate memory for the decoded data
-    std::vector<uint8_t> data(static_cast<size_t>(fHeader.width * fHeader.height));
+    std::vector<uint8_t> data(size_t(fHeader.width) * size_t(fHeader.height));
 
-    decompressFrameIn(frameNumber, data.data());
+    if (!decompressFrameIn(frameNumber, data.data())) return {};
     return data;
 }
 
-void DC6::decompressFrameIn(size_t frameNumber, uint8_t* data) const
+namespace
 {
-    assert(stream != nullptr);
-    stream->seek(framePointers[frameNumber] + sizeof(FrameHeader), IStream::beg);
-    const FrameHeader& fHeader = frameHeaders[frameNumber];
-    assert(fHeader.width > 0 && fHeader.height > 0);
-
-    // TODO: figure if we should invert data here or let the renderer do it
-    // assert(!fHeader.flip);
-
-    // We're reading it bottom to top, but save data with the y axis from top to
-    // bottom
+/**Decodes the RLE encoded frame data of a frame from memory
+ * @param image Of the size of the frame. Transparent pixels are left untouched.
+ * @return false if the data would be written outside of the frame
+ */
+bool decodeFrameRLE(const uint8_t* encodedData, const DC6::FrameHeader& fHeader,
+                    ImageView<uint8_t> image)
+{
+    const uint8_t* const encodedEnd = encodedData + fHeader.length;
+    // We're reading it bottom to top, but save data with the y axis from top to bottom
     int x = 0, y = fHeader.height - 1;
-    int rawIndex = 0;
-    while (rawIndex < fHeader.length)
+    while (encodedData < encodedEnd)
     {
-        int val = stream->getc();
-        rawIndex++;
-        if (val == EOF) throw;
-        uint8_t chunkSize = static_cast<uint8_t>(val);
+        const uint8_t chunkSize = *encodedData++;
         if (chunkSize == 0x80) // end of line
         {
             x = 0;
             y--;
         }
-        else if (chunkSize & 0x80) // chunkSize & 0x80 is the number of transparent pixels
+        else if (chunkSize & 0x80) // chunkSize & 0x7F is the number of transparent pixels
         {
             x += chunkSize & 0x7F;
         }
         else // chunkSize is the number of colors to read
         {
-            assert(chunkSize + x <= fHeader.width);
-            for (int i = 0; i < chunkSize; i++, x++)
-            {
-                int color = stream->getc();
-                rawIndex++;
-                if (color == EOF) throw;
-                assert(x >= 0 && y >= 0 && x + fHeader.width * y < fHeader.width * fHeader.height);
-                data[static_cast<size_t>(x + fHeader.width * y)] = static_cast<uint8_t>(color);
+            if (y < 0 || x + chunkSize > fHeader.width || chunkSize > encodedEnd - encodedData) {
+                return false;
             }
+            memcpy(&image(size_t(x), size_t(y)), encodedData, chunkSize);
+            encodedData += chunkSize;
+            x += chunkSize;
         }
     }
-    assert(fHeader.length == rawIndex);
+    return true;
+}
+} // anonymous namespace
+
+bool DC6::decompressFrameIn(size_t frameNumber, uint8_t* data) const
+{
+    assert(stream != nullptr);
+    const FrameHeader& fHeader = frameHeaders[frameNumber];
+    if (fHeader.width <= 0 || fHeader.height <= 0) return false;
+
+    // TODO: figure if we should invert data here or let the renderer do it
+    // assert(!fHeader.flip);
+
+    const uint8_t* encodedData = getFrameData(frameNumber);
+    if (!encodedData) return false;
+    const size_t width = size_t(fHeader.width);
+    return decodeFrameRLE(encodedData, fHeader, {data, width, size_t(fHeader.height), width});
+}
+
+bool DC6::decompressAll(IImageProvider<uint8_t>& imgProvider, ThreadPool& threadPool) const
+{
+    assert(stream != nullptr);
+    const size_t framesNumber = frameHeaders.size();
+
+    size_t nbPixels = 0;
+    for (const FrameHeader& fHeader : frameHeaders)
+    {
+        if (fHeader.width > 0 && fHeader.height > 0)
+            nbPixels += size_t(fHeader.width) * size_t(fHeader.height);
+    }
+    imgProvider.reserve(framesNumber, nbPixels);
+
+    // Allocate the images from this thread, so that the provider does not need to be thread-safe
+    std::vector<ImageView<uint8_t>> images(framesNumber);
+    for (size_t frame = 0; frame < framesNumber; ++frame)
+    {
+        const FrameHeader& fHeader = frameHeaders[frame];
+        if (fHeader.width <= 0 || fHeader.height <= 0 || !getFrameData(frame)) return false;
+
+        images[frame] = imgProvider.getNewImage(size_t(fHeader.width), size_t(fHeader.height));
+        if (!images[frame].isValid()) return false;
+    }
+
+    std::atomic<bool> success{true};
+    threadPool.parallelFor(framesNumber, [&](size_t frame) {
+        ImageView<uint8_t> image = images[frame];
+        image.fillBytes(0, 0, image.width, image.height, 0);
+        if (!decodeFrameRLE(getFrameData(frame), frameHeaders[frame], image)) success = false;
+    });
+    return success;
 }
 
 void DC6::exportToPPM(const char* ppmFilenameBase, const Palette& palette) const
@@ -115,6 +181,7 @@ void DC6::exportToPPM(const char* ppmFilenameBase, const Palette& palette) const
         {
             size_t frame = dir * header.framesPerDir + frameInDir;
             auto   data  = decompressFrame(frame);
+            if (data.empty()) continue;
             Utils::exportToPPM(fmt::format("{}{}-{}.ppm", ppmFilenameBase, dir, frameInDir).c_str(),
                                data.data(), frameHeaders[frame].width, frameHeaders[frame].height,
                                palette);
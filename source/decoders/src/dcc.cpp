@@ -6,17 +6,27 @@
 
 #include "dcc.h"
 #include <BitStream.h>
+#include <CpuFeatures.h>
+#include <ThreadPool.h>
 #include <array>
 #include <assert.h>
+#include <atomic>
 #include <fmt/format.h>
+#include <string.h>
+#include <unordered_map>
 #include "ImageView.h"
 #include "palette.h"
 #include "utils.h"
 
+#ifdef WS_X86
+#include <immintrin.h>
+#endif
+
 namespace WorldStone
 {
 
 constexpr unsigned DCC::bitsWidthTable[16];
+constexpr size_t   DCC::BlockDictionary::blockSize;
 // constexpr unsigned DCC::bitsWidthTable[16] = {0,  1,  2,  4,  6,  8,  10, 12,
 //                                              14, 16, 20, 24, 26, 28, 30, 32};
 
@@ -76,11 +86,24 @@ bool DCC::extractHeaderAndOffsets()
     return stream->good();
 }
 
-size_t DCC::getDirectionSize(uint32_t dirIndex)
+size_t DCC::getDirectionSize(uint32_t dirIndex) const
 {
     return directionsOffsets[dirIndex + 1] - directionsOffsets[dirIndex];
 }
 
+const uint8_t* DCC::getEncodedData(size_t offset, size_t size, Vector<uint8_t>& fallbackBuffer)
+{
+    // The bitstream reads whole words, so ask for some padding that it may read out of bounds.
+    const size_t   paddedSize = size + BitStreamView::tailPaddingBytes;
+    const uint8_t* view       = stream->tryGetContiguousView(offset, paddedSize);
+    if (view) return view;
+
+    fallbackBuffer.resize(paddedSize);
+    stream->seek(long(offset), IStream::beg);
+    if (stream->read(fallbackBuffer.data(), size) != size) return nullptr;
+    return fallbackBuffer.data();
+}
+
 static bool readDirHeader(DCC::DirectionHeader& dirHeader, BitStreamView& bitStream)
 {
     dirHeader.outsizeCoded          = bitStream.readUnsigned(32);
@@ -132,9 +155,12 @@ static bool readFrameHeaders(uint8_t nbFrames, DCC::Direction& outDir, BitStream
             fHdr.extents.yUpper = fHdr.yOffset + 1;
         }
     }
+    return bitStream.good();
+}
 
-    // Handle optional data
-    for (DCC::FrameHeader& frameHeader : outDir.frameHeaders)
+static bool skipFramesOptionalData(const DCC::Direction& dir, BitStreamView& bitStream)
+{
+    for (const DCC::FrameHeader& frameHeader : dir.frameHeaders)
     {
         if (frameHeader.optionalBytes) {
             assert(false && "Please report the name of the DCC file to the devs!");
@@ -144,6 +170,24 @@ static bool readFrameHeaders(uint8_t nbFrames, DCC::Direction& outDir, BitStream
     }
     return bitStream.good();
 }
+
+/// Size in bits of the direction header
+static constexpr size_t dirHeaderSizeInBits = 32 + 2 + 7 * 4;
+
+/// Size in bits of the direction header and of the frame headers that follow it
+static size_t computeHeadersSizeInBits(const DCC::DirectionHeader& dirHeader, size_t nbFrames)
+{
+    constexpr auto bitsWidthTable    = DCC::bitsWidthTable;
+    const size_t   frameHeaderInBits = bitsWidthTable[dirHeader.variable0Bits] +
+                                       bitsWidthTable[dirHeader.widthBits] +
+                                       bitsWidthTable[dirHeader.heightBits] +
+                                       bitsWidthTable[dirHeader.xOffsetBits] +
+                                       bitsWidthTable[dirHeader.yOffsetBits] +
+                                       bitsWidthTable[dirHeader.optionalBytesBits] +
+                                       bitsWidthTable[dirHeader.codedBytesBits] + 1u;
+    return dirHeaderSizeInBits + nbFrames * frameHeaderInBits;
+}
+
 namespace
 { // Do not expose internals
 // For the pixel buffer the maximum size of a cell is 4
@@ -162,23 +206,37 @@ struct PixelBufferEntry
     uint8_t                 values[nbValues];
 };
 
+/// What the 2nd stage has to do for a cell of a frame, decided by the 1st stage
+enum class CellKind : uint8_t
+{
+    Decoded,       ///< Uses the next pixel buffer entry of the frame
+    Cleared,       ///< Same as previous, but its size changed so it is filled with 0
+    SameAsPrevious ///< Keeps the pixels of the previous frames at the same position
+};
+
 struct FrameData
 {
     using CellSize = uint8_t;
 
     size_t   firstPixelBufferEntry;
+    size_t   firstPixelCodeIndexBit; ///< Position of the frame pixel code indices for stage 2
+    size_t   nbPixelCodeIndexBits;   ///< Number of bits of the frame pixel code indices
+    size_t   firstCell;              ///< Index of the first cell in DirectionData::cellKinds
     uint16_t nbCellsX;
     uint16_t nbCellsY;
     uint16_t offsetX; ///< X Offset relative to the whole direction bounding box
     uint16_t offsetY; ///< Y Offset relative to the whole direction bounding box
 
-    Vector<bool>     cellSameAsPrevious;
-    Vector<CellSize> cellWidths;
-    Vector<CellSize> cellHeights;
+    /// Only the first and last columns/rows can have a size different from 4
+    CellSize firstCellWidth;
+    CellSize lastCellWidth;
+    CellSize firstCellHeight;
+    CellSize lastCellHeight;
 
-    ImageView<uint8_t> imageView; ///< Output buffer image view
-    FrameData(const DCC::Direction& dir, const DCC::FrameHeader& frameHeader,
-              IImageProvider<uint8_t>& imgProvider)
+    ImageView<uint8_t> imageView; ///< Output buffer image view, if allocated by the caller
+
+    FrameData(const DCC::Direction& dir, const DCC::FrameHeader& frameHeader, size_t firstCellIndex)
+        : firstCell(firstCellIndex)
     {
         offsetX = uint16_t(frameHeader.extents.xLower - dir.extents.xLower);
         offsetY = uint16_t(frameHeader.extents.yLower - dir.extents.yLower);
@@ -207,44 +265,58 @@ struct FrameData
             if ((tmp % 4) == 0) nbCellsY--;
         }
 
-        cellSameAsPrevious.resize(nbCellsX * nbCellsY);
-
-        // Initialize to 4 by default
-        cellWidths.resize(nbCellsX, 4);
-        cellHeights.resize(nbCellsY, 4);
-
         if (nbCellsX == 1)
-            cellWidths[0] = CellSize(frameWidth); // Might have merged 2nd column into 1st
+            firstCellWidth = lastCellWidth = CellSize(frameWidth); // Might have merged 2nd column
         else
         {
             // Treat the special cases (first and last columns/rows)
-            cellWidths[0] = CellSize(widthFirstColumn);
+            firstCellWidth = CellSize(widthFirstColumn);
             // Compute size of the last column
             const size_t nbColumnsExcludingFirstAndLast    = nbCellsX - 2;
             const size_t widthExcludingFirstAndLastColumns = 4 * nbColumnsExcludingFirstAndLast;
-            cellWidths[nbCellsX - 1] =
+            lastCellWidth =
                 CellSize(frameWidth - (widthFirstColumn + widthExcludingFirstAndLastColumns));
         }
 
         if (nbCellsY == 1)
-            cellHeights[0] = CellSize(frameHeight); // Might have merged 2nd row into 1st
+            firstCellHeight = lastCellHeight = CellSize(frameHeight); // Might have merged 2nd row
         else
         {
-            cellHeights[0] = CellSize(heightFirstRow);
+            firstCellHeight = CellSize(heightFirstRow);
             // Compute size of the last row
             const size_t nbRowsExcludingFirstAndLast     = nbCellsY - 2;
             const size_t heightExcludingFirstAndLastRows = 4 * nbRowsExcludingFirstAndLast;
-            cellHeights[nbCellsY - 1] =
+            lastCellHeight =
                 CellSize(frameHeight - (heightFirstRow + heightExcludingFirstAndLastRows));
         }
+    }
 
-        imageView = imgProvider.getNewImage(frameWidth, frameHeight);
+    size_t nbCells() const { return size_t(nbCellsX) * nbCellsY; }
+    size_t cellWidth(size_t cellX) const
+    {
+        return cellX == 0 ? firstCellWidth : (cellX == nbCellsX - 1u ? lastCellWidth : 4u);
+    }
+    size_t cellHeight(size_t cellY) const
+    {
+        return cellY == 0 ? firstCellHeight : (cellY == nbCellsY - 1u ? lastCellHeight : 4u);
     }
 };
 
+/// The state of the 1st stage that is kept from one frame to the next
+struct Stage1PixelBuffer
+{
+    /// For each cell, index of the last PixelBufferEntry. Used to retrieve the previous values.
+    Vector<size_t> lastEntries;
+    /// For each cell, size of the last frame cell. Same size cells are not cleared by stage 2.
+    Vector<Cell> lastCellSizes;
+};
+
+/**The decoding state of a direction.
+ * It can be reused for other directions by calling init again, which keeps the memory allocated.
+ */
 struct DirectionData
 {
-    const DCC::Direction& dirRef;
+    const DCC::Direction* dirRef = nullptr;
 
     Vector<uint8_t> codeToPixelValue;
 
@@ -257,13 +329,21 @@ struct DirectionData
     size_t nbFrames;
     size_t nbPixelBufferCellsX;
     size_t nbPixelBufferCellsY;
+    size_t nbPixelCodeIndexBits; ///< Size of the pixel code indices of all frames
 
-    Vector<FrameData> framesData;
+    Vector<FrameData>        framesData;
+    Vector<CellKind>         cellKinds;         ///< The cells of all frames, set by the 1st stage
+    Vector<PixelBufferEntry> pbEntries;         ///< Filled by the 1st stage
+    Stage1PixelBuffer        stage1Buffer;      ///< Only used during the 1st stage
+    Vector<uint8_t>          pixelBufferColors; ///< See resetPixelBuffer
 
-    DirectionData(const DCC::Direction& dir, BitStreamView& bitStream, size_t nbFramesPerDir,
-                  IImageProvider<uint8_t>& imgProvider)
-        : dirRef(dir), nbFrames(nbFramesPerDir)
+    void init(const DCC::Direction& dir, BitStreamView& bitStream, size_t nbFramesPerDir)
     {
+        dirRef               = &dir;
+        nbFrames             = nbFramesPerDir;
+        nbPixelCodeIndexBits = 0;
+        pbEntries.clear();
+
         uint32_t equalCellsBitStreamSize    = 0;
         uint32_t pixelMaskBitStreamSize     = 0;
         uint32_t encodingTypeBitsreamSize   = 0;
@@ -285,6 +365,7 @@ struct DirectionData
         // code 0 gives 0
         // code 1 gives 31
         // code 2 gives 42
+        codeToPixelValue.clear();
         codeToPixelValue.reserve(256);
         for (size_t i = 0; i < 256; i++)
         {
@@ -323,20 +404,58 @@ struct DirectionData
         nbPixelBufferCellsX = 1u + (dirWidth - 1u) / pbCellMaxPixelSize;
         nbPixelBufferCellsY = 1u + (dirHeight - 1u) / pbCellMaxPixelSize;
 
+        framesData.clear();
         framesData.reserve(nbFrames);
 
+        size_t nbCells = 0;
         for (size_t frameIndex = 0; frameIndex < nbFrames; ++frameIndex)
         {
-            framesData.emplace_back(dir, dir.frameHeaders[frameIndex], imgProvider);
+            framesData.emplace_back(dir, dir.frameHeaders[frameIndex], nbCells);
+            nbCells += framesData.back().nbCells();
         }
+        cellKinds.resize(nbCells);
     }
 
-    /// Check that all the data is valid and allocated
-    bool isValid() const
+    /**Returns a cleared pixel buffer of the size of the direction.
+     * When decoding the frames in order, it holds the pixels of the previous frames for the cells
+     * that did not change, which is cheaper than copying them from the previous frames.
+     */
+    ImageView<uint8_t> resetPixelBuffer()
     {
+        const size_t dirWidth  = size_t(dirRef->extents.width());
+        const size_t dirHeight = size_t(dirRef->extents.height());
+        pixelBufferColors.assign(dirWidth * dirHeight, 0);
+        return {pixelBufferColors.data(), dirWidth, dirHeight, dirWidth};
+    }
+
+    /// Returns the view of the pixel buffer where a frame is decoded
+    ImageView<uint8_t> pixelBufferFrameView(ImageView<uint8_t> pixelBuffer, size_t frameIndex) const
+    {
+        const DCC::FrameHeader& frameHeader = dirRef->frameHeaders[frameIndex];
+        const FrameData&        frameData   = framesData[frameIndex];
+        return pixelBuffer.subView(frameData.offsetX, frameData.offsetY,
+                                   size_t(frameHeader.extents.width()),
+                                   size_t(frameHeader.extents.height()));
+    }
+
+    /// Allocates the images of the frames, in order
+    bool allocateImages(IImageProvider<uint8_t>& imgProvider)
+    {
+        size_t nbPixels = 0;
+        for (size_t frameIndex = 0; frameIndex < nbFrames; ++frameIndex)
+        {
+            const DCC::FrameHeader& frameHeader = dirRef->frameHeaders[frameIndex];
+            nbPixels += size_t(frameHeader.extents.width()) * size_t(frameHeader.extents.height());
+        }
+        imgProvider.reserve(nbFrames, nbPixels);
+
         for (size_t frameIndex = 0; frameIndex < nbFrames; ++frameIndex)
         {
-            if (!framesData[frameIndex].imageView.isValid()) return false;
+            const DCC::FrameHeader& frameHeader = dirRef->frameHeaders[frameIndex];
+            ImageView<uint8_t>&     imageView   = framesData[frameIndex].imageView;
+            imageView = imgProvider.getNewImage(size_t(frameHeader.extents.width()),
+                                                size_t(frameHeader.extents.height()));
+            if (!imageView.isValid()) return false;
         }
         return true;
     }
@@ -392,13 +511,111 @@ int decodePixelCodesStack(DirectionData& data, uint8_t pixelMask, PixelCodesStac
     return int(curPixelIdx);
 }
 
-void decodeFrameStage1(DirectionData& data, FrameData& frameData, Vector<size_t>& pixelBuffer,
+/**Number of bits used in the 2nd stage to select the value of each pixel of a cell.
+ * A cell uses at most 4 colors, a bit like DXT.
+ */
+unsigned pixelCodeIndexBits(const PixelBufferEntry& entry)
+{
+    // Only got one pixel code, the cell is filled with it
+    if (entry.values[0] == entry.values[1]) return 0;
+    // Stopped decoding after the 2nd value, 1 bit is enough to choose between the two values
+    if (entry.values[1] == entry.values[2]) return 1;
+    // We need 2 bits to index 3-4 values
+    return 2;
+}
+
+/// The pixel code indices of a 4x4 cell, one byte per pixel in row-major order
+struct CellIndices
+{
+    uint64_t rows01; ///< Rows 0 and 1
+    uint64_t rows23; ///< Rows 2 and 3
+};
+
+/// Spreads the 2 bits indices of 2 rows of 4 pixels (16 bits) to one byte per pixel
+uint64_t spread2BitsIndices(uint64_t indices)
+{
+    indices = (indices | indices << 24) & 0x000000FF000000FFull;
+    indices = (indices | indices << 12) & 0x000F000F000F000Full;
+    indices = (indices | indices << 6) & 0x0303030303030303ull;
+    return indices;
+}
+
+/// Spreads the 1 bit indices of 2 rows of 4 pixels (8 bits) to one byte per pixel
+uint64_t spread1BitIndices(uint64_t indices)
+{
+    indices = (indices | indices << 28) & 0x0000000F0000000Full;
+    indices = (indices | indices << 14) & 0x0003000300030003ull;
+    indices = (indices | indices << 7) & 0x0101010101010101ull;
+    return indices;
+}
+
+/**Spreads the pixel code indices of a 4x4 cell, read with a single bitstream access.
+ * @param packedIndices The 16 indices, the first pixel in the least significant bits
+ * @param nbBits        The size of each index, 1 or 2
+ */
+CellIndices spreadCellIndices(uint32_t packedIndices, unsigned nbBits)
+{
+    if (nbBits == 1)
+        return {spread1BitIndices(packedIndices & 0xFF), spread1BitIndices(packedIndices >> 8)};
+    return {spread2BitsIndices(packedIndices & 0xFFFF), spread2BitsIndices(packedIndices >> 16)};
+}
+
+using WriteCellFunction = void (*)(CellIndices indices, const PixelBufferEntry& entry,
+                                   uint8_t* destination, size_t stride);
+
+void writeCellScalar(CellIndices indices, const PixelBufferEntry& entry, uint8_t* destination,
+                     size_t stride)
+{
+    for (size_t row = 0; row < 4; row++)
+    {
+        const uint64_t rowIndices = (row < 2 ? indices.rows01 : indices.rows23) >> (32 * (row % 2));
+        uint8_t*       rowPixels  = destination + row * stride;
+        for (size_t x = 0; x < 4; x++)
+        {
+            rowPixels[x] = entry.values[(rowIndices >> (8 * x)) & 0x3];
+        }
+    }
+}
+
+#ifdef WS_X86
+/// Looks up the 16 pixels at once, the 4 values of the entry being used as a byte shuffle table
+WS_TARGET("ssse3")
+void writeCellSSSE3(CellIndices indices, const PixelBufferEntry& entry, uint8_t* destination,
+                    size_t stride)
+{
+    int32_t table;
+    memcpy(&table, entry.values, sizeof(table));
+    const __m128i pixels =
+        _mm_shuffle_epi8(_mm_cvtsi32_si128(table), _mm_set_epi64x(int64_t(indices.rows23),
+                                                                  int64_t(indices.rows01)));
+    const int32_t rows[4] = {
+        _mm_cvtsi128_si32(pixels), _mm_cvtsi128_si32(_mm_srli_si128(pixels, 4)),
+        _mm_cvtsi128_si32(_mm_srli_si128(pixels, 8)),
+        _mm_cvtsi128_si32(_mm_srli_si128(pixels, 12))};
+    for (size_t row = 0; row < 4; row++)
+    {
+        memcpy(destination + row * stride, &rows[row], sizeof(rows[row]));
+    }
+}
+#endif
+
+WriteCellFunction selectWriteCell()
+{
+#ifdef WS_X86
+    if (CpuFeatures::get().ssse3) return &writeCellSSSE3;
+#endif
+    return &writeCellScalar;
+}
+
+void decodeFrameStage1(DirectionData& data, FrameData& frameData, Stage1PixelBuffer& pixelBuffer,
                        Vector<PixelBufferEntry>& pbEntries)
 {
     // Offset in terms of cells for this frame
     const size_t frameCellOffsetX = frameData.offsetX / 4;
     const size_t frameCellOffsetY = frameData.offsetY / 4;
 
+    frameData.firstPixelCodeIndexBit = data.nbPixelCodeIndexBits;
+
     // For each cell of this frame (not the same number as the pixel buffer cells ! )
     for (size_t y = 0; y < frameData.nbCellsY; y++)
     {
@@ -410,7 +627,12 @@ void decodeFrameStage1(DirectionData& data, FrameData& frameData, Vector<size_t>
             const size_t curPbCellIndex    = curCellX + curCellY * data.nbPixelBufferCellsX;
             const size_t curFrameCellIndex = x + y * frameData.nbCellsX;
 
-            size_t& lastPixelEntryIndexForCell = pixelBuffer[curPbCellIndex];
+            size_t& lastPixelEntryIndexForCell = pixelBuffer.lastEntries[curPbCellIndex];
+            Cell&   lastCellSize               = pixelBuffer.lastCellSizes[curPbCellIndex];
+
+            Cell frameCell;
+            frameCell.width  = frameData.cellWidth(x);
+            frameCell.height = frameData.cellHeight(y);
 
             bool    sameAsPreviousCell = false; // By default always decode the cell
             uint8_t pixelMask          = 0x0F;  // Default pixel mask
@@ -418,7 +640,7 @@ void decodeFrameStage1(DirectionData& data, FrameData& frameData, Vector<size_t>
             // Check if this cell is equal to the previous one
             if (lastPixelEntryIndexForCell < pbEntries.size()) {
                 // Check if we have to reuse the previous values
-                if (data.dirRef.header.compressEqualCells) {
+                if (data.dirRef->header.compressEqualCells) {
                     // If true, the cell is the same as the previous one or transparent.
                     // Which actually mean the same thing : skip the decoding of this cell
                     sameAsPreviousCell = data.equalCellBitStream.readBool();
@@ -428,10 +650,17 @@ void decodeFrameStage1(DirectionData& data, FrameData& frameData, Vector<size_t>
                 }
             }
 
-            // Store the fact that we skipped this cell for the 2nd phase
-            frameData.cellSameAsPrevious[curFrameCellIndex] = sameAsPreviousCell;
+            // Store what to do with this cell for the 2nd phase
+            CellKind& cellKind = data.cellKinds[frameData.firstCell + curFrameCellIndex];
+            if (sameAsPreviousCell) {
+                const bool sameSize = frameCell.width == lastCellSize.width &&
+                                      frameCell.height == lastCellSize.height;
+                cellKind = sameSize ? CellKind::SameAsPrevious : CellKind::Cleared;
+            }
+            else
+            {
+                cellKind = CellKind::Decoded;
 
-            if (!sameAsPreviousCell) {
                 // Pixel buffer entries are encoded as a stack in the stream which means the
                 // last value decoded is actually the 1st value with a bit in the mask.
                 PixelCodesStack pixelCodesStack = {};
@@ -476,18 +705,32 @@ void decodeFrameStage1(DirectionData& data, FrameData& frameData, Vector<size_t>
                 lastPixelEntryIndexForCell = pbEntries.size();
                 // Add the new entry for use in the 2nd stage
                 pbEntries.push_back(newEntry);
+
+                // Keep track of where the pixel code indices of each frame start
+                data.nbPixelCodeIndexBits +=
+                    pixelCodeIndexBits(newEntry) * frameCell.width * frameCell.height;
             }
+            lastCellSize = frameCell;
         }
     }
+    frameData.nbPixelCodeIndexBits = data.nbPixelCodeIndexBits - frameData.firstPixelCodeIndexBit;
 }
 
-void decodeDirectionStage1(DirectionData& data, Vector<PixelBufferEntry>& pbEntries)
+/**Runs the 1st stage for all the frames of the direction.
+ * The pixel code indices used by the 2nd stage follow the data of the 1st stage of all frames,
+ * so this must be done before decoding any frame.
+ * @return false if the pixel code indices of the frames would not fit in the direction
+ */
+bool decodeDirectionStage1(DirectionData& data)
 {
-    // For each cell store a PixelBufferEntry index that points to the last entry for this cell
-    // This will be used to retrieve values from the previous frame
-    constexpr size_t    invalidIndex       = std::numeric_limits<size_t>::max();
-    const size_t        pixelBufferNbCells = data.nbPixelBufferCellsX * data.nbPixelBufferCellsY;
-    Vector<size_t>      pixelBuffer(pixelBufferNbCells, invalidIndex);
+    Vector<PixelBufferEntry>& pbEntries = data.pbEntries;
+    pbEntries.reserve((data.nbFrames * data.nbPixelBufferCellsX * data.nbPixelBufferCellsY) / 4);
+
+    constexpr size_t   invalidIndex       = std::numeric_limits<size_t>::max();
+    const size_t       pixelBufferNbCells = data.nbPixelBufferCellsX * data.nbPixelBufferCellsY;
+    Stage1PixelBuffer& pixelBuffer        = data.stage1Buffer;
+    pixelBuffer.lastEntries.assign(pixelBufferNbCells, invalidIndex);
+    pixelBuffer.lastCellSizes.assign(pixelBufferNbCells, Cell{0xF, 0xF});
 
     // 1st phase of decoding : fill the pixel buffer
     // We actually fill a buffer of entries as to avoid storing empty entries
@@ -497,166 +740,547 @@ void decodeDirectionStage1(DirectionData& data, Vector<PixelBufferEntry>& pbEntr
         frameData.firstPixelBufferEntry = pbEntries.size();
         decodeFrameStage1(data, frameData, pixelBuffer, pbEntries);
     }
+
+    // Make sure we fully read the streams
+    assert(data.equalCellBitStream.tell() == data.equalCellBitStream.sizeInBits());
+    assert(data.pixelMaskBitStream.tell() == data.pixelMaskBitStream.sizeInBits());
+    assert(data.rawPixelUsageBitStream.tell() == data.rawPixelUsageBitStream.sizeInBits());
+    assert(data.rawPixelCodesBitStream.tell() == data.rawPixelCodesBitStream.sizeInBits());
+
+    // Stage 2 jumps to the pixel code indices of each frame, make sure they are in the direction
+    const BitStreamView& pixelCodeIndices = data.pixelCodesDisplacementBitStream;
+    if (pixelCodeIndices.bitPositionInBuffer() + data.nbPixelCodeIndexBits >
+        pixelCodeIndices.bufferSizeInBits())
+        return false;
+    // This exact stream size is not known, so check if we at least are in the last byte
+    assert(pixelCodeIndices.bitPositionInBuffer() + data.nbPixelCodeIndexBits + 7_z >=
+           pixelCodeIndices.bufferSizeInBits());
+    return true;
 }
 
-void decodeDirectionStage2(DirectionData& data, const Vector<PixelBufferEntry>& pbEntries)
+/**Decodes the cells of a frame that do not depend on the previous frames.
+ * Since the 1st stage gave us the position of the frame pixel code indices, frames can be
+ * decoded concurrently. The cells that are the same as in the previous frames are left untouched.
+ * @param frameImage Where to write the frame pixels
+ */
+void decodeFrameStage2(const DirectionData& data, const FrameData& frameData,
+                       ImageView<uint8_t> frameImage)
 {
-    // This is the reason why we need to stages, we don't have the offset of this bitstream
-    BitStreamView& pixelCodeIndices = data.pixelCodesDisplacementBitStream;
+    // The pixel code indices of all frames follow the data read during the 1st stage
+    BitStreamView pixelCodeIndices = data.pixelCodesDisplacementBitStream;
+    if (frameData.nbPixelCodeIndexBits) pixelCodeIndices.skip(frameData.firstPixelCodeIndexBit);
 
-    const size_t pbWidth            = size_t(data.dirRef.extents.width());
-    const size_t pbHeight           = size_t(data.dirRef.extents.height());
-    const size_t pbStride           = pbWidth;
-    const size_t nbPixelBufferCells = data.nbPixelBufferCellsX * data.nbPixelBufferCellsY;
+    static const WriteCellFunction writeCell = selectWriteCell();
 
-    Vector<Cell>       pixelBufferCells(nbPixelBufferCells, Cell{0xF, 0xF});
-    Vector<uint8_t>    pixelBufferColors(pbStride * pbHeight);
-    ImageView<uint8_t> pBuffer{pixelBufferColors.data(), pbWidth, pbHeight, pbStride};
+    const CellKind* frameKinds   = data.cellKinds.data() + frameData.firstCell;
+    size_t          pbEntryIndex = frameData.firstPixelBufferEntry;
 
-    // 2nd phase of decoding : Finish using the pixel buffer entries
-    for (size_t frameIndex = 0; frameIndex < data.nbFrames; ++frameIndex)
+    size_t cellPosY = 0;
+    for (size_t cellY = 0; cellY < frameData.nbCellsY; cellY++)
     {
-        const FrameData& frameData    = data.framesData[frameIndex];
-        size_t           pbEntryIndex = frameData.firstPixelBufferEntry;
-
-        size_t pbCellPosY = frameData.offsetY;
-        for (size_t cellY = 0; cellY < frameData.nbCellsY; cellY++)
+        const size_t cellHeight = frameData.cellHeight(cellY);
+        size_t       cellPosX   = 0;
+        for (size_t cellX = 0; cellX < frameData.nbCellsX; cellX++)
         {
-            size_t pbCellPosX = frameData.offsetX;
-            for (size_t cellX = 0; cellX < frameData.nbCellsX; cellX++)
+            const size_t cellWidth = frameData.cellWidth(cellX);
+            switch (frameKinds[cellX + cellY * frameData.nbCellsX])
             {
-                const size_t frameCellIndex = cellX + cellY * frameData.nbCellsX;
-                Cell         frameCell;
-                frameCell.width  = frameData.cellWidths[cellX];
-                frameCell.height = frameData.cellHeights[cellY];
-
-                const size_t pbCellIndex =
-                    (pbCellPosX / pbCellMaxPixelSize) +
-                    (pbCellPosY / pbCellMaxPixelSize) * data.nbPixelBufferCellsX;
-                Cell& pbCell = pixelBufferCells[pbCellIndex];
-
-                if (frameData.cellSameAsPrevious[frameCellIndex]) {
-                    if ((frameCell.width != pbCell.width) || (frameCell.height != pbCell.height)) {
-                        // Clear the cell to 0
-                        // If we used the previous frame pixels instead of reusing the same
-                        // buffer for all frames we would not need to clear this (it would be
-                        // initialized to 0 before writing any value to the frame pixels) But we
-                        // would then need to copy values if the size matched
-                        pBuffer.fillBytes(pbCellPosX, pbCellPosY, frameCell.width, frameCell.height,
-                                          0);
-                    }
-                    else
+            case CellKind::SameAsPrevious: break; // See copyEqualCells
+            case CellKind::Cleared:
+                frameImage.fillBytes(cellPosX, cellPosY, cellWidth, cellHeight, 0);
+                break;
+            case CellKind::Decoded:
+            {
+                const PixelBufferEntry& entry        = data.pbEntries[pbEntryIndex++];
+                const unsigned          nbBitsToRead = pixelCodeIndexBits(entry);
+                if (nbBitsToRead == 0) {
+                    frameImage.fillBytes(cellPosX, cellPosY, cellWidth, cellHeight,
+                                         entry.values[0]);
+                    break;
+                }
+                if (cellWidth == 4 && cellHeight == 4) {
+                    // Most cells are full, read all their indices at once (32 bits at most)
+                    const uint32_t packedIndices =
+                        pixelCodeIndices.readUnsigned(16 * nbBitsToRead);
+                    writeCell(spreadCellIndices(packedIndices, nbBitsToRead), entry,
+                              &frameImage(cellPosX, cellPosY), frameImage.stride);
+                    break;
+                }
+                // fill FRAME cell with pixels
+                for (size_t y = 0; y < cellHeight; y++)
+                {
+                    for (size_t x = 0; x < cellWidth; x++)
                     {
-                        // Same size, copy from previous cell in the buffer
-                        // Nothing to change !
+                        const uint8_t pixelCodeIndex =
+                            pixelCodeIndices.readUnsigned8OrLess(int(nbBitsToRead));
+                        frameImage(cellPosX + x, cellPosY + y) = entry.values[pixelCodeIndex];
                     }
                 }
-                else
-                {
-                    const auto& pixelValues = pbEntries[pbEntryIndex++].values;
+                break;
+            }
+            }
+            cellPosX += cellWidth;
+        }
+        cellPosY += cellHeight;
+    }
+    assert(!frameData.nbPixelCodeIndexBits ||
+           pixelCodeIndices.tell() == data.pixelCodesDisplacementBitStream.tell() +
+                                          frameData.firstPixelCodeIndexBit +
+                                          frameData.nbPixelCodeIndexBits);
+}
 
-                    if (pixelValues[0] == pixelValues[1]) {
-                        // This means we only got one pixel code, so fill the cell with it
-                        pBuffer.fillBytes(pbCellPosX, pbCellPosY, frameCell.width, frameCell.height,
-                                          pixelValues[0]);
-                    }
-                    else
-                    {
-                        int nbBitsToRead = 0;
-                        if (pixelValues[1] == pixelValues[2]) {
-                            // Stopped decoding after the 2nd value, only pixelValues[0] and
-                            // pixelValues[1] are different, so only 1bit needs to be read to choose
-                            // from those values
-                            nbBitsToRead = 1;
-                        }
-                        else // We need 2 bits to index 3-4 values
-                        {
-                            nbBitsToRead = 2;
-                        }
+/**Returns the value of a pixel of the direction before the frame lastFrameIndex + 1 is decoded.
+ * Frames write every pixel of their extents, so this is the value of the pixel in the last frame
+ * containing it.
+ */
+uint8_t previousPixelValue(const DirectionData& data, size_t lastFrameIndex, size_t x, size_t y)
+{
+    for (size_t frameIndex = lastFrameIndex + 1; frameIndex-- > 0;)
+    {
+        const FrameData&          frameData  = data.framesData[frameIndex];
+        const ImageView<uint8_t>& frameImage = frameData.imageView;
+        if (x >= frameData.offsetX && x < frameData.offsetX + frameImage.width &&
+            y >= frameData.offsetY && y < frameData.offsetY + frameImage.height) {
+            return frameImage(x - frameData.offsetX, y - frameData.offsetY);
+        }
+    }
+    // The pixel buffer is initialized to 0
+    return 0;
+}
 
-                        // fill FRAME cell with pixels
-                        for (size_t y = 0; y < frameCell.height; y++)
-                        {
-                            for (size_t x = 0; x < frameCell.width; x++)
-                            {
-                                const uint8_t pixelCodeIndex =
-                                    pixelCodeIndices.readUnsigned8OrLess(nbBitsToRead);
-                                // Note: This actually means that a cell (4x4 block) can use at most
-                                // 4 colors, a bit like DXT !
-                                const uint8_t pixelValue = pixelValues[pixelCodeIndex];
-
-                                pBuffer(pbCellPosX + x, pbCellPosY + y) = pixelValue;
-                            }
-                        }
+/**Copies the pixels of the cells that are the same as in the previous frames.
+ * This is what a single pixel buffer shared by all frames would contain, so frames must be
+ * processed in order, after the 2nd stage.
+ */
+void copyEqualCells(const DirectionData& data, size_t frameIndex)
+{
+    const FrameData& frameData  = data.framesData[frameIndex];
+    const CellKind*  frameKinds = data.cellKinds.data() + frameData.firstCell;
+
+    size_t cellPosY = 0;
+    for (size_t cellY = 0; cellY < frameData.nbCellsY; cellY++)
+    {
+        const size_t cellHeight = frameData.cellHeight(cellY);
+        size_t       cellPosX   = 0;
+        for (size_t cellX = 0; cellX < frameData.nbCellsX; cellX++)
+        {
+            const size_t cellWidth = frameData.cellWidth(cellX);
+            if (frameKinds[cellX + cellY * frameData.nbCellsX] != CellKind::SameAsPrevious) {
+                cellPosX += cellWidth;
+                continue;
+            }
+            const ImageView<uint8_t> cell =
+                frameData.imageView.subView(cellPosX, cellPosY, cellWidth, cellHeight);
+            // Position of the cell in the direction
+            const size_t dirPosX = frameData.offsetX + cellPosX;
+            const size_t dirPosY = frameData.offsetY + cellPosY;
+
+            // Most of the time the previous frame contains the whole cell, so copy it at once
+            const FrameData& previousFrame = data.framesData[frameIndex - 1];
+            const ImageView<uint8_t> previousCell =
+                dirPosX < previousFrame.offsetX || dirPosY < previousFrame.offsetY
+                    ? ImageView<uint8_t>{}
+                    : previousFrame.imageView.subView(dirPosX - previousFrame.offsetX,
+                                                      dirPosY - previousFrame.offsetY,
+                                                      cellWidth, cellHeight);
+            if (previousCell.isValid()) {
+                previousCell.copyTo(cell);
+            }
+            else
+            {
+                for (size_t y = 0; y < cellHeight; y++)
+                {
+                    for (size_t x = 0; x < cellWidth; x++)
+                    {
+                        cell(x, y) = previousPixelValue(data, frameIndex - 1, dirPosX + x,
+                                                        dirPosY + y);
                     }
                 }
-
-                pbCell = frameCell;
-                pbCellPosX += frameCell.width;
             }
-            pbCellPosY += frameData.cellHeights[cellY];
+            cellPosX += cellWidth;
         }
-        // Done decoding this frame, now copy its content.
-        const ImageView<uint8_t> frameImageView = frameData.imageView;
-        const ImageView<uint8_t> pbFrameView    = pBuffer.subView(
-            frameData.offsetX, frameData.offsetY, frameImageView.width, frameImageView.height);
-        assert(frameImageView.isValid() && pbFrameView.isValid());
+        cellPosY += cellHeight;
+    }
+}
 
-        pbFrameView.copyTo(frameImageView);
+void decodeDirectionStage2(DirectionData& data, ThreadPool* threadPool)
+{
+    // 2nd phase of decoding : Finish using the pixel buffer entries
+    if (threadPool) {
+        threadPool->parallelFor(data.nbFrames, [&data](size_t frameIndex) {
+            const FrameData& frameData = data.framesData[frameIndex];
+            decodeFrameStage2(data, frameData, frameData.imageView);
+        });
+        // The first frame has no equal cells, as there is no previous value for its cells
+        for (size_t frameIndex = 1; frameIndex < data.nbFrames; ++frameIndex)
+        {
+            copyEqualCells(data, frameIndex);
+        }
+    }
+    else
+    {
+        const ImageView<uint8_t> pixelBuffer = data.resetPixelBuffer();
+        for (size_t frameIndex = 0; frameIndex < data.nbFrames; ++frameIndex)
+        {
+            const FrameData&         frameData = data.framesData[frameIndex];
+            const ImageView<uint8_t> pbFrameView =
+                data.pixelBufferFrameView(pixelBuffer, frameIndex);
+            decodeFrameStage2(data, frameData, pbFrameView);
+            pbFrameView.copyTo(frameData.imageView);
+        }
+    }
 
 /// Set to 1 to export the frames to the grayscale PPM format
 #define DEBUG_EXPORT_PPM 0
 #if DEBUG_EXPORT_PPM
-/// Set to export all the frames at the size of the pixel buffer (not cleared outside of the frame)
-#define EXPORT_FULL_SIZE false
+    for (size_t frameIndex = 0; frameIndex < data.nbFrames; ++frameIndex)
+    {
         auto filename = fmt::format("test{}.ppm", frameIndex);
-        Utils::exportToPGM(filename.c_str(), EXPORT_FULL_SIZE ? pBuffer : frameImageView);
+        Utils::exportToPGM(filename.c_str(), data.framesData[frameIndex].imageView);
+    }
 #endif
+}
+
+/// Reads the direction header and the frame headers, then computes the direction extents
+bool readDirectionAndFrameHeaders(DCC::Direction& outDir, BitStreamView& bitStream,
+                                  uint8_t framesPerDir)
+{
+    if (!readDirHeader(outDir.header, bitStream)) return false;
+
+    if (!readFrameHeaders(framesPerDir, outDir, bitStream)) return false;
+
+    if (!skipFramesOptionalData(outDir, bitStream)) return false;
+
+    outDir.computeDirExtents();
+    return true;
+}
+
+/**Decodes a direction from its encoded data.
+ * @param directionData The encoded direction, padded by BitStreamView::tailPaddingBytes.
+ * @param data          The decoding state, reused to avoid allocations.
+ * @param threadPool    If not nullptr, used to decode the frames concurrently.
+ * @note Only touches outDir, imgProvider and data, so directions can be decoded concurrently.
+ */
+bool decodeDirection(DCC::Direction& outDir, const uint8_t* directionData, size_t directionSize,
+                     uint8_t framesPerDir, IImageProvider<uint8_t>& imgProvider,
+                     DirectionData& data, ThreadPool* threadPool)
+{
+    BitStreamView bitStream(directionData, directionSize * CHAR_BIT);
+    if (!readDirectionAndFrameHeaders(outDir, bitStream, framesPerDir)) return false;
+
+    data.init(outDir, bitStream, framesPerDir);
+    if (!data.allocateImages(imgProvider)) return false;
+
+    if (!decodeDirectionStage1(data)) return false;
+
+    decodeDirectionStage2(data, threadPool);
+
+    return bitStream.good();
+}
+
+/// Hashes the pixels of a block, used to find the identical blocks
+struct BlockHash
+{
+    size_t operator()(const DCC::BlockDictionary::Block& block) const
+    {
+        uint64_t halves[2];
+        static_assert(sizeof(halves) == sizeof(block), "A block should be 16 bytes");
+        memcpy(halves, block.data(), sizeof(halves));
+        const uint64_t hash = halves[0] * 0x9E3779B97F4A7C15ull ^ halves[1] * 0xC2B2AE3D27D4EB4Full;
+        return size_t(hash ^ (hash >> 32));
     }
+};
+/// Index of each block in BlockDictionary::blocks
+using BlockIndices = std::unordered_map<DCC::BlockDictionary::Block, uint32_t, BlockHash>;
+
+/**Adds the blocks of a frame to the dictionary, and references them for this frame.
+ * @param pixelBuffer The pixel buffer of the direction, in which the frame was decoded
+ */
+void addFrameBlocks(const DirectionData& data, size_t frameIndex,
+                    ImageView<const uint8_t> pixelBuffer, BlockIndices& blockIndices,
+                    DCC::BlockDictionary& outBlocks)
+{
+    using BlockDictionary = DCC::BlockDictionary;
+    constexpr size_t blockSize = BlockDictionary::blockSize;
+
+    const DCC::FrameHeader& frameHeader = data.dirRef->frameHeaders[frameIndex];
+    const FrameData&        frameData   = data.framesData[frameIndex];
+    // Frame boundaries in the direction, the upper ones being excluded
+    const size_t frameXLower = frameData.offsetX;
+    const size_t frameYLower = frameData.offsetY;
+    const size_t frameXUpper = frameXLower + size_t(frameHeader.extents.width());
+    const size_t frameYUpper = frameYLower + size_t(frameHeader.extents.height());
+
+    for (size_t cellY = frameYLower / blockSize; cellY * blockSize < frameYUpper; cellY++)
+    {
+        for (size_t cellX = frameXLower / blockSize; cellX * blockSize < frameXUpper; cellX++)
+        {
+            BlockDictionary::Block block;
+            bool                   transparent = true;
+            for (size_t y = 0; y < blockSize; y++)
+            {
+                const size_t dirY      = cellY * blockSize + y;
+                const bool   rowInside = dirY >= frameYLower && dirY < frameYUpper;
+                for (size_t x = 0; x < blockSize; x++)
+                {
+                    const size_t  dirX   = cellX * blockSize + x;
+                    const bool    inside = rowInside && dirX >= frameXLower && dirX < frameXUpper;
+                    const uint8_t pixel  = inside ? pixelBuffer(dirX, dirY) : 0;
+                    block[x + y * blockSize] = pixel;
+                    if (pixel) transparent = false;
+                }
+            }
+            if (transparent) continue;
+
+            const auto insertion = blockIndices.emplace(block, uint32_t(outBlocks.blocks.size()));
+            if (insertion.second) outBlocks.blocks.push_back(block);
+            outBlocks.blockRefs.push_back(
+                {uint16_t(cellX), uint16_t(cellY), insertion.first->second});
+        }
+    }
+    outBlocks.framesFirstBlockRef.push_back(outBlocks.blockRefs.size());
+}
+
+/**Decodes a direction from its encoded data as a dictionary of blocks.
+ * The frames are decoded in order in the pixel buffer, then split in blocks.
+ * @see decodeDirection
+ */
+bool decodeDirectionBlocks(DCC::Direction& outDir, const uint8_t* directionData,
+                           size_t directionSize, uint8_t framesPerDir,
+                           DCC::BlockDictionary& outBlocks, DirectionData& data)
+{
+    outBlocks.clear();
+    BitStreamView bitStream(directionData, directionSize * CHAR_BIT);
+    if (!readDirectionAndFrameHeaders(outDir, bitStream, framesPerDir)) return false;
+
+    data.init(outDir, bitStream, framesPerDir);
+    if (!decodeDirectionStage1(data)) return false;
+
+    BlockIndices blockIndices;
+    outBlocks.framesFirstBlockRef.reserve(data.nbFrames + 1);
+    outBlocks.framesFirstBlockRef.push_back(0);
+    const ImageView<uint8_t> pixelBuffer = data.resetPixelBuffer();
+    for (size_t frameIndex = 0; frameIndex < data.nbFrames; ++frameIndex)
+    {
+        decodeFrameStage2(data, data.framesData[frameIndex],
+                          data.pixelBufferFrameView(pixelBuffer, frameIndex));
+        addFrameBlocks(data, frameIndex, pixelBuffer, blockIndices, outBlocks);
+    }
+
+    return bitStream.good();
 }
 } // anonymous namespace
+
+struct DCC::DecodeContext::Impl
+{
+    Vector<uint8_t> encodedBuffer; ///< Holds the direction if the stream has no view
+    DirectionData   data;
+};
+
+DCC::DecodeContext::DecodeContext() : impl(std::make_unique<Impl>()) {}
+DCC::DecodeContext::~DecodeContext() = default;
+DCC::DecodeContext::DecodeContext(DecodeContext&&) = default;
+DCC::DecodeContext& DCC::DecodeContext::operator=(DecodeContext&&) = default;
+
+void DCC::DecodeContext::releaseMemory() { impl = std::make_unique<Impl>(); }
+
 bool DCC::readDirection(Direction& outDir, uint32_t dirIndex, IImageProvider<uint8_t>& imgProvider)
+{
+    DecodeContext context;
+    return readDirection(outDir, dirIndex, imgProvider, context, nullptr);
+}
+
+bool DCC::readDirection(Direction& outDir, uint32_t dirIndex, IImageProvider<uint8_t>& imgProvider,
+                        ThreadPool& threadPool)
+{
+    DecodeContext context;
+    return readDirection(outDir, dirIndex, imgProvider, context, &threadPool);
+}
+
+bool DCC::readDirection(Direction& outDir, uint32_t dirIndex, IImageProvider<uint8_t>& imgProvider,
+                        DecodeContext& context)
+{
+    return readDirection(outDir, dirIndex, imgProvider, context, nullptr);
+}
+
+bool DCC::readDirection(Direction& outDir, uint32_t dirIndex, IImageProvider<uint8_t>& imgProvider,
+                        DecodeContext& context, ThreadPool* threadPool)
 {
     if (dirIndex >= header.directions) return false;
 
-    const size_t    directionEncodedSize = getDirectionSize(dirIndex);
-    Vector<uint8_t> buffer(directionEncodedSize);
-    stream->seek(directionsOffsets[dirIndex], IStream::beg);
-    stream->read(buffer.data(), directionEncodedSize);
-    assert(stream->good());
-    BitStreamView bitStream(buffer.data(), directionEncodedSize * CHAR_BIT);
+    const size_t   directionEncodedSize = getDirectionSize(dirIndex);
+    const uint8_t* directionData        = getEncodedData(
+        directionsOffsets[dirIndex], directionEncodedSize, context.impl->encodedBuffer);
+    if (!directionData) return false;
 
-    DirectionHeader& dirHeader = outDir.header;
-    if (!readDirHeader(dirHeader, bitStream)) return false;
+    return decodeDirection(outDir, directionData, directionEncodedSize, header.framesPerDir,
+                           imgProvider, context.impl->data, threadPool);
+}
 
-    if (!readFrameHeaders(header.framesPerDir, outDir, bitStream)) return false;
+bool DCC::readDirection(Direction& outDir, uint32_t dirIndex, BlockDictionary& outBlocks)
+{
+    DecodeContext context;
+    return readDirection(outDir, dirIndex, outBlocks, context);
+}
 
-    outDir.computeDirExtents();
+bool DCC::readDirection(Direction& outDir, uint32_t dirIndex, BlockDictionary& outBlocks,
+                        DecodeContext& context)
+{
+    if (dirIndex >= header.directions) return false;
+
+    const size_t   directionEncodedSize = getDirectionSize(dirIndex);
+    const uint8_t* directionData        = getEncodedData(
+        directionsOffsets[dirIndex], directionEncodedSize, context.impl->encodedBuffer);
+    if (!directionData) return false;
 
-    DirectionData data{outDir, bitStream, header.framesPerDir, imgProvider};
-    if (!data.isValid()) return false;
+    return decodeDirectionBlocks(outDir, directionData, directionEncodedSize, header.framesPerDir,
+                                 outBlocks, context.impl->data);
+}
 
-    Vector<PixelBufferEntry> pbEntries;
+bool DCC::readAllDirections(Vector<Direction>& outDirections, ThreadPool& threadPool,
+                            const ImageProviderFactory& providerFactory)
+{
+    const uint32_t nbDirections = header.directions;
+    outDirections.resize(nbDirections);
+    if (nbDirections == 0) return true;
+
+    // The directions are stored contiguously, so read all of them but the last one at once.
+    // The last one is read separately as the file has no padding after it.
+    const size_t    firstDirOffset = directionsOffsets[0];
+    const size_t    lastDirOffset  = directionsOffsets[nbDirections - 1];
+    Vector<uint8_t> buffer;
+    Vector<uint8_t> lastDirBuffer;
+    const uint8_t*  firstDirsData = nullptr;
+    if (nbDirections > 1) {
+        firstDirsData = getEncodedData(firstDirOffset, lastDirOffset - firstDirOffset, buffer);
+        if (!firstDirsData) return false;
+    }
+    const uint8_t* lastDirData =
+        getEncodedData(lastDirOffset, getDirectionSize(nbDirections - 1), lastDirBuffer);
+    if (!lastDirData) return false;
+
+    // Get the providers from this thread, so that the factory does not need to be thread-safe
+    Vector<IImageProvider<uint8_t>*> providers(nbDirections);
+    for (uint32_t dirIndex = 0; dirIndex < nbDirections; dirIndex++)
     {
-        size_t estimatedNbEntries =
-            (header.framesPerDir * data.nbPixelBufferCellsX * data.nbPixelBufferCellsY) / 4;
-        pbEntries.reserve(estimatedNbEntries);
+        providers[dirIndex] = &providerFactory(dirIndex);
     }
 
-    decodeDirectionStage1(data, pbEntries);
+    std::atomic<bool> success{true};
+    threadPool.parallelFor(nbDirections, [&](size_t dirIndex) {
+        const uint8_t* dirData = dirIndex == nbDirections - 1
+                                     ? lastDirData
+                                     : firstDirsData + directionsOffsets[dirIndex] - firstDirOffset;
+        DirectionData data;
+        if (!decodeDirection(outDirections[dirIndex], dirData, getDirectionSize(uint32_t(dirIndex)),
+                             header.framesPerDir, *providers[dirIndex], data, &threadPool))
+            success = false;
+    });
+    return success;
+}
 
-    decodeDirectionStage2(data, pbEntries);
+bool DCC::readDirectionHeaders(Direction& outDir, uint32_t dirIndex)
+{
+    if (dirIndex >= header.directions) return false;
 
-    // Make sure we fully read the streams
-    assert(data.equalCellBitStream.tell() == data.equalCellBitStream.sizeInBits());
-    assert(data.pixelMaskBitStream.tell() == data.pixelMaskBitStream.sizeInBits());
-    assert(data.rawPixelUsageBitStream.tell() == data.rawPixelUsageBitStream.sizeInBits());
-    assert(data.rawPixelCodesBitStream.tell() == data.rawPixelCodesBitStream.sizeInBits());
-    // This exact stream size is not known, so check if we at least are in the last byte
-    assert(data.pixelCodesDisplacementBitStream.bitPositionInBuffer() + 7_z >=
-           data.pixelCodesDisplacementBitStream.bufferSizeInBits());
+    // Only read the beginning of the direction. The size of the frame headers is known once the
+    // direction header is read, so this is done in two steps.
+    const size_t    directionSize = getDirectionSize(dirIndex);
+    const size_t    dirOffset     = directionsOffsets[dirIndex];
+    Vector<uint8_t> buffer;
+
+    if (directionSize * CHAR_BIT < dirHeaderSizeInBits) return false;
+    size_t         readSize = (dirHeaderSizeInBits + 7_z) / CHAR_BIT;
+    const uint8_t* data     = getEncodedData(dirOffset, readSize, buffer);
+    if (!data) return false;
+    BitStreamView dirHeaderStream(data, readSize * CHAR_BIT);
+    if (!readDirHeader(outDir.header, dirHeaderStream)) return false;
+
+    const size_t headersSize = computeHeadersSizeInBits(outDir.header, header.framesPerDir);
+    if (directionSize * CHAR_BIT < headersSize) return false;
+    readSize = (headersSize + 7_z) / CHAR_BIT;
+    data     = getEncodedData(dirOffset, readSize, buffer);
+    if (!data) return false;
+    BitStreamView bitStream(data, readSize * CHAR_BIT);
+    if (!readDirHeader(outDir.header, bitStream)) return false;
+    if (!readFrameHeaders(header.framesPerDir, outDir, bitStream)) return false;
 
-    return bitStream.good();
+    outDir.computeDirExtents();
+    return true;
+}
+
+struct DCC::DirectionDecoder::Impl
+{
+    Vector<uint8_t>    encodedBuffer; ///< Holds the direction if the stream has no view
+    Direction          direction;
+    DirectionData      data;
+    ImageView<uint8_t> pixelBuffer; ///< Shared by all frames, see DirectionData::resetPixelBuffer
+    size_t             nextFrame = 0;
+};
+
+DCC::DirectionDecoder::DirectionDecoder()  = default;
+DCC::DirectionDecoder::~DirectionDecoder() = default;
+DCC::DirectionDecoder::DirectionDecoder(DirectionDecoder&&) = default;
+DCC::DirectionDecoder& DCC::DirectionDecoder::operator=(DirectionDecoder&&) = default;
+
+bool DCC::DirectionDecoder::initDecoder(DCC& dcc, uint32_t dirIndex)
+{
+    impl.reset();
+    if (dirIndex >= dcc.header.directions) return false;
+
+    auto           newImpl       = std::make_unique<Impl>();
+    const size_t   directionSize = dcc.getDirectionSize(dirIndex);
+    const uint8_t* directionData =
+        dcc.getEncodedData(dcc.directionsOffsets[dirIndex], directionSize, newImpl->encodedBuffer);
+    if (!directionData) return false;
+
+    BitStreamView bitStream(directionData, directionSize * CHAR_BIT);
+    const uint8_t framesPerDir = dcc.header.framesPerDir;
+    if (!readDirectionAndFrameHeaders(newImpl->direction, bitStream, framesPerDir)) return false;
+
+    newImpl->data.init(newImpl->direction, bitStream, framesPerDir);
+    if (!decodeDirectionStage1(newImpl->data) || !bitStream.good()) return false;
+
+    newImpl->pixelBuffer = newImpl->data.resetPixelBuffer();
+    impl = std::move(newImpl);
+    return true;
+}
+
+const DCC::Direction& DCC::DirectionDecoder::getDirection() const
+{
+    assert(impl);
+    return impl->direction;
+}
+
+size_t DCC::DirectionDecoder::getNextFrameIndex() const { return impl ? impl->nextFrame : 0; }
+
+bool DCC::DirectionDecoder::hasNextFrame() const
+{
+    return impl && impl->nextFrame < impl->data.nbFrames;
+}
+
+bool DCC::DirectionDecoder::decodeNextFrame(ImageView<uint8_t> frameImage)
+{
+    if (!hasNextFrame()) return false;
+
+    const ImageView<uint8_t> pbFrameView =
+        impl->data.pixelBufferFrameView(impl->pixelBuffer, impl->nextFrame);
+    assert(pbFrameView.isValid());
+    if (!frameImage.buffer || frameImage.width < pbFrameView.width ||
+        frameImage.height < pbFrameView.height || frameImage.width > frameImage.stride)
+        return false;
+
+    decodeFrameStage2(impl->data, impl->data.framesData[impl->nextFrame], pbFrameView);
+    pbFrameView.copyTo(frameImage);
+    impl->nextFrame++;
+    return true;
+}
+
+void DCC::DirectionDecoder::rewind()
+{
+    if (!impl) return;
+    impl->pixelBuffer = impl->data.resetPixelBuffer();
+    impl->nextFrame   = 0;
 }
 
 } // namespace WorldStone
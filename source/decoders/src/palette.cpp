@@ -3,8 +3,16 @@
 //
 
 #include "palette.h"
+#include <assert.h>
 #include <stdio.h>
+#include <string.h>
+#include <CpuFeatures.h>
 #include <FileStream.h>
+
+#ifdef WS_X86
+#include <immintrin.h>
+#endif
+
 namespace WorldStone
 {
 
@@ -17,14 +25,102 @@ void Palette::decode(const char* filename)
 void Palette::decode(IStream* file)
 {
     if (file && file->good()) {
+        uint8_t rawColors[colorCount * 3];
+        file->read(rawColors, sizeof(rawColors));
+        valid = file->good();
+        if (!valid) return;
         for (size_t i = 0; i < colorCount; i++)
         {
             // order is BGR, not RGB
-            colors[i].b = static_cast<uint8_t>(file->getc());
-            colors[i].g = static_cast<uint8_t>(file->getc());
-            colors[i].r = static_cast<uint8_t>(file->getc());
+            colors[i].b = rawColors[i * 3 + 0];
+            colors[i].g = rawColors[i * 3 + 1];
+            colors[i].r = rawColors[i * 3 + 2];
         }
-        valid = file->good();
+        updatePackedColors();
+    }
+}
+
+void Palette::updatePackedColors()
+{
+    for (size_t i = 0; i < colorCount; i++)
+    {
+        const Color&  c     = colors[i];
+        const uint8_t alpha = i == 0 ? 0 : 255;
+        // Use memcpy so that the byte order does not depend on the endianness
+        const uint8_t rgba[4] = {c.r, c.g, c.b, alpha};
+        const uint8_t bgra[4] = {c.b, c.g, c.r, alpha};
+        memcpy(&rgba32[i], rgba, sizeof(rgba));
+        memcpy(&bgra32[i], bgra, sizeof(bgra));
+    }
+}
+
+void Palette::expandIndexedToRGBA(ImageView<const uint8_t> source,
+                                  ImageView<uint32_t>      destination) const
+{
+    expandIndexedColors(source, destination, rgba32);
+}
+
+namespace
+{
+using ExpandRowFunction = void (*)(const uint8_t* source, uint32_t* destination, size_t count,
+                                   const uint32_t* table);
+
+void expandRowScalar(const uint8_t* source, uint32_t* destination, size_t count,
+                     const uint32_t* table)
+{
+    size_t i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        destination[i + 0] = table[source[i + 0]];
+        destination[i + 1] = table[source[i + 1]];
+        destination[i + 2] = table[source[i + 2]];
+        destination[i + 3] = table[source[i + 3]];
+    }
+    for (; i < count; i++)
+    {
+        destination[i] = table[source[i]];
+    }
+}
+
+#ifdef WS_X86
+/// Looks up 8 colors per gather, the 256 entries table being too big for byte shuffles
+WS_TARGET("avx2")
+void expandRowAVX2(const uint8_t* source, uint32_t* destination, size_t count,
+                   const uint32_t* table)
+{
+    const int* tableAsInts = reinterpret_cast<const int*>(table);
+    size_t     i           = 0;
+    for (; i + 16 <= count; i += 16)
+    {
+        const __m128i indices   = _mm_loadu_si128(reinterpret_cast<const __m128i*>(source + i));
+        const __m256i indicesLo = _mm256_cvtepu8_epi32(indices);
+        const __m256i indicesHi = _mm256_cvtepu8_epi32(_mm_srli_si128(indices, 8));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i),
+                            _mm256_i32gather_epi32(tableAsInts, indicesLo, 4));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(destination + i + 8),
+                            _mm256_i32gather_epi32(tableAsInts, indicesHi, 4));
+    }
+    expandRowScalar(source + i, destination + i, count - i, table);
+}
+#endif
+
+ExpandRowFunction selectExpandRow()
+{
+#ifdef WS_X86
+    if (CpuFeatures::get().avx2) return &expandRowAVX2;
+#endif
+    return &expandRowScalar;
+}
+} // anonymous namespace
+
+void expandIndexedColors(ImageView<const uint8_t> source, ImageView<uint32_t> destination,
+                         const Palette::PackedColors& table)
+{
+    assert(destination.width >= source.width && destination.height >= source.height);
+    static const ExpandRowFunction expandRow = selectExpandRow();
+    for (size_t y = 0; y < source.height; y++)
+    {
+        expandRow(&source(0, y), &destination(0, y), source.width, table.data());
     }
 }
 } // namespace WorldStone
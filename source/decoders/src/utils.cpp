@@ -2,7 +2,9 @@
 // Created by Lectem on 05/11/2016.
 //
 #include "utils.h"
+#include <assert.h>
 #include <stdio.h>
+#include <vector>
 #include <fmt/format.h>
 #include "palette.h"
 
@@ -44,12 +46,20 @@ void exportToPPM(const char* output, const uint8_t* data, int width, int height,
     FILE* file = fopen(output, "wb");
     if (file) {
         fmt::print(file, "P6 {} {} 255\n", width, height);
-        for (size_t i = 0; i < static_cast<size_t>(width * height); ++i)
+        // Write the file line by line instead of calling fputc for each channel
+        const auto&          colors = palette.colors;
+        std::vector<uint8_t> line(static_cast<size_t>(width) * 3);
+        for (int y = 0; y < height; ++y)
         {
-            const auto& colors = palette.colors;
-            fputc(colors[data[i]].r, file);
-            fputc(colors[data[i]].g, file);
-            fputc(colors[data[i]].b, file);
+            const uint8_t* lineIndices = data + static_cast<size_t>(y * width);
+            for (size_t x = 0; x < static_cast<size_t>(width); ++x)
+            {
+                const Palette::Color& color = colors[lineIndices[x]];
+                line[x * 3 + 0]             = color.r;
+                line[x * 3 + 1]             = color.g;
+                line[x * 3 + 2]             = color.b;
+            }
+            fwrite(line.data(), 1, line.size(), file);
         }
         fclose(file);
     }
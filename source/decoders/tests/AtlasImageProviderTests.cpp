@@ -0,0 +1,119 @@
+/**
+ * @file AtlasImageProviderTests.cpp
+ * @brief Implementation of the tests of AtlasImageProvider
+ */
+
+#include <FileStream.h>
+#include <dcc.h>
+#include <doctest.h>
+#include "AtlasImageProvider.h"
+
+using WorldStone::AtlasImageProvider;
+using WorldStone::ImageView;
+using WorldStone::Vector;
+
+/**@testimpl{WorldStone::AtlasImageProvider,AtlasImageProvider}
+ * Images must be placed in the pages without overlapping, and be usable as any other image.
+ */
+TEST_CASE("AtlasImageProvider")
+{
+    using Atlas           = AtlasImageProvider<uint16_t>;
+    const size_t pageSize = 64;
+    Atlas        atlas{pageSize, pageSize};
+    CHECK(atlas.getPagesNumber() == 0);
+    CHECK_FALSE(atlas.getNewImage(0, 4).isValid());
+    CHECK(atlas.getImagesNumber() == 0);
+
+    // Fill each image with its index, so that overlaps can be detected afterwards
+    uint32_t seed = 42;
+    auto     rand = [&seed](size_t max) {
+        seed = seed * 1664525u + 1013904223u;
+        return 1 + (seed >> 16) % max;
+    };
+    const size_t nbImages = 300;
+    for (size_t i = 0; i < nbImages; i++)
+    {
+        // One image is wider than the pages
+        const size_t        width  = i == 100 ? pageSize + 10 : rand(24);
+        const size_t        height = i == 100 ? 5 : rand(24);
+        ImageView<uint16_t> image  = atlas.getNewImage(width, height);
+        REQUIRE(image.isValid());
+        CHECK(image.width == width);
+        CHECK(image.height == height);
+        image.fill(0, 0, width, height, uint16_t(i + 1));
+    }
+    REQUIRE(atlas.getImagesNumber() == nbImages);
+    CHECK(atlas.getPagesNumber() > 1);
+
+    size_t usedPixels = 0;
+    for (size_t i = 0; i < nbImages; i++)
+    {
+        CAPTURE(i);
+        const Atlas::Placement&         placement = atlas.getPlacement(i);
+        const ImageView<const uint16_t> page      = atlas.getPage(placement.page);
+        REQUIRE(placement.x + placement.width <= page.width);
+        REQUIRE(placement.y + placement.height <= page.height);
+        CHECK(atlas.getImage(i).buffer == &page(placement.x, placement.y));
+        CHECK(atlas.getImage(i).stride == page.width);
+
+        bool untouched = true;
+        for (size_t y = 0; y < placement.height; y++)
+        {
+            for (size_t x = 0; x < placement.width; x++)
+            {
+                if (page(placement.x + x, placement.y + y) != i + 1) untouched = false;
+            }
+        }
+        CHECK(untouched);
+
+        const Atlas::UVRect uv = atlas.getUVRect(i);
+        CHECK(uv.u0 == float(placement.x) / float(page.width));
+        CHECK(uv.v1 == float(placement.y + placement.height) / float(page.height));
+        if (placement.width <= pageSize) usedPixels += placement.width * placement.height;
+    }
+
+    // The image wider than a page got its own page
+    const Atlas::Placement& bigImage = atlas.getPlacement(100);
+    CHECK(atlas.getPage(bigImage.page).width == pageSize + 10);
+    CHECK(atlas.getPage(bigImage.page).height == 5);
+    for (size_t i = 0; i < nbImages; i++)
+    {
+        if (i != 100) CHECK(atlas.getPlacement(i).page != bigImage.page);
+    }
+    // The packing should not waste too much space
+    CHECK(usedPixels * 3 > (atlas.getPagesNumber() - 1) * pageSize * pageSize * 2);
+}
+
+/**@testimpl{WorldStone::AtlasImageProvider,AtlasImageProvider}
+ * Decoding in an atlas must give the same frames as decoding in separate images.
+ */
+TEST_CASE("AtlasImageProvider with DCC")
+{
+    using WorldStone::DCC;
+    DCC dcc;
+    REQUIRE(dcc.initDecoder(std::make_unique<WorldStone::FileStream>("HZTRLITA1HTH.dcc")));
+
+    AtlasImageProvider<uint8_t>              atlas{256, 256};
+    WorldStone::SimpleImageProvider<uint8_t> expectedImgs;
+    for (uint32_t dirIndex = 0; dirIndex < dcc.getHeader().directions; dirIndex++)
+    {
+        DCC::Direction dir;
+        REQUIRE(dcc.readDirection(dir, dirIndex, atlas));
+        REQUIRE(dcc.readDirection(dir, dirIndex, expectedImgs));
+    }
+    REQUIRE(atlas.getImagesNumber() == expectedImgs.getImagesNumber());
+    for (size_t i = 0; i < atlas.getImagesNumber(); i++)
+    {
+        const ImageView<const uint8_t> image    = atlas.getImage(i);
+        const ImageView<const uint8_t> expected = expectedImgs.getImage(i);
+        REQUIRE(image.width == expected.width);
+        REQUIRE(image.height == expected.height);
+        bool sameContent = true;
+        for (size_t y = 0; y < image.height; y++)
+        {
+            if (memcmp(&image(0, y), &expected(0, y), image.width) != 0) sameContent = false;
+        }
+        CHECK(sameContent);
+    }
+    CHECK(atlas.getPagesNumber() < atlas.getImagesNumber() / 8);
+}
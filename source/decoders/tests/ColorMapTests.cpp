@@ -0,0 +1,116 @@
+/**
+ * @file ColorMapTests.cpp
+ */
+#include <MemoryStream.h>
+#include <colormap.h>
+#include "doctest.h"
+
+using WorldStone::ColorMap;
+using WorldStone::ImageView;
+using WorldStone::MemoryStream;
+using WorldStone::Vector;
+
+namespace
+{
+/// Generates a colormap where the variant v maps the index i to (i * 3 + v) % 256
+Vector<uint8_t> makeColorMapFile(size_t variantsCount)
+{
+    Vector<uint8_t> file;
+    for (size_t variant = 0; variant < variantsCount; variant++)
+    {
+        for (size_t i = 0; i < ColorMap::variantSize; i++)
+        {
+            file.push_back(uint8_t(i * 3 + variant));
+        }
+    }
+    return file;
+}
+} // anonymous namespace
+
+/// @testimpl{WorldStone::ColorMap,ColorMap}
+TEST_CASE("ColorMap decoding")
+{
+    SUBCASE("Every 256 bytes is a variant")
+    {
+        ColorMap     colorMap;
+        MemoryStream stream{makeColorMapFile(21)};
+        colorMap.decode(&stream);
+        REQUIRE(colorMap.isValid());
+        CHECK(colorMap.getVariantsCount() == 21);
+        CHECK(colorMap.getVariant(0)[1] == 3);
+        CHECK(colorMap.getVariant(20)[255] == uint8_t(255 * 3 + 20));
+    }
+    SUBCASE("Files that do not contain whole variants are invalid")
+    {
+        Vector<uint8_t> file = makeColorMapFile(2);
+        file.pop_back();
+        ColorMap     colorMap;
+        MemoryStream stream{std::move(file)};
+        colorMap.decode(&stream);
+        CHECK_FALSE(colorMap.isValid());
+        CHECK(colorMap.getVariantsCount() == 0);
+    }
+    SUBCASE("Empty files are invalid")
+    {
+        ColorMap     colorMap;
+        MemoryStream stream{Vector<uint8_t>{}};
+        colorMap.decode(&stream);
+        CHECK_FALSE(colorMap.isValid());
+    }
+}
+
+/// @testimpl{WorldStone::ColorMap,ColorMap}
+TEST_CASE("ColorMap remapping")
+{
+    ColorMap     colorMap;
+    MemoryStream stream{makeColorMapFile(4)};
+    colorMap.decode(&stream);
+    REQUIRE(colorMap.isValid());
+
+    // Odd sizes to test both the vectorized loop and the remaining pixels
+    const size_t    width = 45, height = 3, stride = 50;
+    Vector<uint8_t> indices(stride * height);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        indices[i] = uint8_t(i * 11);
+    }
+    const size_t variant = 3;
+    // Pixels outside of the image must not be modified
+    auto expectedValue = [&](size_t x, size_t y) {
+        const uint8_t original = indices[x + y * stride];
+        return x < width ? colorMap.getVariant(variant)[original] : original;
+    };
+
+    SUBCASE("To another image")
+    {
+        const uint8_t      guardValue = 0xCD;
+        Vector<uint8_t>    pixels(stride * height, guardValue);
+        ImageView<uint8_t> destination{pixels.data(), width, height, stride};
+        remap({indices.data(), width, height, stride}, destination, colorMap, variant);
+        bool allPixelsMatch = true;
+        for (size_t y = 0; y < height; y++)
+        {
+            for (size_t x = 0; x < stride; x++)
+            {
+                const uint8_t expected = x < width ? expectedValue(x, y) : guardValue;
+                allPixelsMatch &= destination(x, y) == expected;
+            }
+        }
+        CHECK(allPixelsMatch);
+    }
+    SUBCASE("In place")
+    {
+        Vector<uint8_t>    pixels = indices;
+        ImageView<uint8_t> image{pixels.data(), width, height, stride};
+        remap(image, colorMap, variant);
+        bool allPixelsMatch = true;
+        for (size_t y = 0; y < height; y++)
+        {
+            for (size_t x = 0; x < stride; x++)
+            {
+                allPixelsMatch &= image(x, y) == expectedValue(x, y);
+            }
+        }
+        CHECK(allPixelsMatch);
+    }
+}
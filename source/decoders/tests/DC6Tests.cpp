@@ -0,0 +1,223 @@
+/**
+ * @file DC6Tests.cpp
+ * @brief Tests of the DC6 decoder on small generated files.
+ */
+#include <MemoryStream.h>
+#include <ThreadPool.h>
+#include <dc6.h>
+#include <string.h>
+#include "doctest.h"
+
+using WorldStone::DC6;
+using WorldStone::IStream;
+using WorldStone::MemoryStream;
+using WorldStone::Vector;
+
+namespace
+{
+/// A stream that does not support contiguous views, to test the fallback path of the decoder
+class NoViewStream : public IStream
+{
+    MemoryStream memory;
+
+public:
+    size_t readsCount = 0;
+    size_t seeksCount = 0;
+
+    NoViewStream(Vector<uint8_t>&& content) : memory(std::move(content)) {}
+
+    long size() override { return memory.size(); }
+    long tell() override { return memory.tell(); }
+    bool seek(long offset, seekdir origin) override
+    {
+        seeksCount++;
+        return memory.seek(offset, origin);
+    }
+    size_t read(void* buffer, size_t size) override
+    {
+        readsCount++;
+        const size_t readSize = memory.read(buffer, size);
+        if (!memory.good()) setstate(memory.eof() ? eofbit | failbit : failbit);
+        return readSize;
+    }
+};
+
+/// Generates a DC6 file with a single frame, 4x2 by default, made of the given RLE data
+Vector<uint8_t> makeDC6File(const Vector<uint8_t>& frameData, int32_t width = 4, int32_t height = 2)
+{
+    DC6::Header      header       = {6, 1, 0, {0xEE, 0xEE, 0xEE, 0xEE}, 1, 1};
+    const uint32_t   framePointer = sizeof(header) + sizeof(uint32_t);
+    DC6::FrameHeader frameHeader  = {0, width, height, 0, 0, 0, 0, int32_t(frameData.size())};
+
+    Vector<uint8_t> file(framePointer + sizeof(frameHeader) + frameData.size());
+    memcpy(file.data(), &header, sizeof(header));
+    memcpy(file.data() + sizeof(header), &framePointer, sizeof(framePointer));
+    memcpy(file.data() + framePointer, &frameHeader, sizeof(frameHeader));
+    memcpy(file.data() + framePointer + sizeof(frameHeader), frameData.data(), frameData.size());
+    return file;
+}
+
+// Scanlines are stored from bottom to top
+const Vector<uint8_t> validFrameData = {
+    0x81, 0x02, 'a', 'b', 0x80,   // Bottom line: 1 transparent pixel, then 2 colors
+    0x04, 1,    2,   3,   4, 0x80 // Top line: 4 colors
+};
+const uint8_t expectedPixels[] = {1, 2, 3, 4, 0, 'a', 'b', 0};
+
+/// Gives images that are not zero initialized, to check that the transparent pixels are written
+class DirtyImageProvider : public WorldStone::SimpleImageProvider<uint8_t>
+{
+public:
+    WorldStone::ImageView<uint8_t> getNewImage(size_t width, size_t height) override
+    {
+        WorldStone::ImageView<uint8_t> image = SimpleImageProvider::getNewImage(width, height);
+        image.fillBytes(0, 0, width, height, 0xFF);
+        return image;
+    }
+};
+} // anonymous namespace
+
+/// @testimpl{WorldStone::DC6,DC6}
+TEST_CASE("DC6 frame decoding")
+{
+    SUBCASE("From a stream supporting views")
+    {
+        DC6 dc6;
+        REQUIRE(dc6.initDecoder(std::make_unique<MemoryStream>(makeDC6File(validFrameData))));
+        REQUIRE(dc6.getFrameHeaders().size() == 1);
+        const Vector<uint8_t> pixels = dc6.decompressFrame(0);
+        REQUIRE(pixels.size() == sizeof(expectedPixels));
+        CHECK(memcmp(pixels.data(), expectedPixels, sizeof(expectedPixels)) == 0);
+    }
+    SUBCASE("From a stream without views")
+    {
+        DC6 dc6;
+        REQUIRE(dc6.initDecoder(std::make_unique<NoViewStream>(makeDC6File(validFrameData))));
+        REQUIRE(dc6.getFrameHeaders().size() == 1);
+        const Vector<uint8_t> pixels = dc6.decompressFrame(0);
+        REQUIRE(pixels.size() == sizeof(expectedPixels));
+        CHECK(memcmp(pixels.data(), expectedPixels, sizeof(expectedPixels)) == 0);
+    }
+    SUBCASE("The file is read at once, instead of seeking for each frame")
+    {
+        auto          stream    = std::make_unique<NoViewStream>(makeDC6File(validFrameData));
+        NoViewStream& streamRef = *stream;
+        DC6           dc6;
+        REQUIRE(dc6.initDecoder(std::move(stream)));
+        CHECK(streamRef.readsCount == 1);
+        CHECK(streamRef.seeksCount <= 1);
+
+        uint8_t pixels[sizeof(expectedPixels)] = {};
+        REQUIRE(dc6.decompressFrameIn(0, pixels));
+        CHECK(memcmp(pixels, expectedPixels, sizeof(expectedPixels)) == 0);
+        CHECK(streamRef.readsCount == 1);
+    }
+    SUBCASE("Invalid frames are reported instead of being written out of bounds")
+    {
+        const Vector<uint8_t> tooWide      = {0x83, 0x02, 'a', 'b'};
+        const Vector<uint8_t> tooManyLines = {0x80, 0x80, 0x01, 'a'};
+        const Vector<uint8_t> truncatedRun = {0x04, 1, 2};
+        for (const Vector<uint8_t>* frameData : {&tooWide, &tooManyLines, &truncatedRun})
+        {
+            DC6 dc6;
+            REQUIRE(dc6.initDecoder(std::make_unique<MemoryStream>(makeDC6File(*frameData))));
+            uint8_t pixels[sizeof(expectedPixels)] = {};
+            CHECK_FALSE(dc6.decompressFrameIn(0, pixels));
+            CHECK(dc6.decompressFrame(0).empty());
+        }
+    }
+    SUBCASE("Frames with negative dimensions are reported before allocating their pixels")
+    {
+        const int32_t invalidSizes[][2] = {{-4, 2}, {4, -2}, {-4, -2}, {0, 2}};
+        for (const auto& size : invalidSizes)
+        {
+            const int32_t width = size[0], height = size[1];
+            CAPTURE(width);
+            CAPTURE(height);
+            DC6 dc6;
+            REQUIRE(dc6.initDecoder(
+                std::make_unique<MemoryStream>(makeDC6File(validFrameData, width, height))));
+            CHECK(dc6.decompressFrame(0).empty());
+        }
+    }
+    SUBCASE("Truncated files are reported")
+    {
+        Vector<uint8_t> file = makeDC6File(validFrameData);
+        file.resize(file.size() - 2);
+        DC6 dc6;
+        REQUIRE(dc6.initDecoder(std::make_unique<NoViewStream>(std::move(file))));
+        CHECK(dc6.decompressFrame(0).empty());
+
+        // The frame header itself is truncated
+        Vector<uint8_t> truncatedHeader = makeDC6File(validFrameData);
+        truncatedHeader.resize(truncatedHeader.size() - validFrameData.size() - 2);
+        DC6 truncatedDc6;
+        CHECK_FALSE(
+            truncatedDc6.initDecoder(std::make_unique<MemoryStream>(std::move(truncatedHeader))));
+    }
+}
+
+/// @testimpl{WorldStone::DC6,DC6_DecompressAll}
+TEST_CASE("DC6 parallel decoding of all the frames")
+{
+    // Frames with different dimensions, stored in a file with 2 directions of 2 frames
+    const int32_t   sizes[][2] = {{4, 2}, {1, 1}, {4, 3}, {2, 5}};
+    DC6::Header     header     = {6, 1, 0, {0xEE, 0xEE, 0xEE, 0xEE}, 2, 2};
+    Vector<uint8_t> file(sizeof(header) + 4 * sizeof(uint32_t));
+    memcpy(file.data(), &header, sizeof(header));
+    for (uint32_t frame = 0; frame < 4; frame++)
+    {
+        const int32_t   width = sizes[frame][0], height = sizes[frame][1];
+        Vector<uint8_t> frameData;
+        for (int32_t y = 0; y < height; y++)
+        {
+            // One transparent pixel followed by colors
+            frameData.push_back(0x81);
+            if (width > 1) frameData.push_back(uint8_t(width - 1));
+            for (int32_t x = 1; x < width; x++)
+            {
+                frameData.push_back(uint8_t(int32_t(frame) * 16 + x + y));
+            }
+            frameData.push_back(0x80);
+        }
+        const uint32_t   framePointer = uint32_t(file.size());
+        DC6::FrameHeader frameHeader  = {0, width, height, 0, 0, 0, 0, int32_t(frameData.size())};
+        memcpy(file.data() + sizeof(header) + frame * sizeof(uint32_t), &framePointer,
+               sizeof(framePointer));
+        file.resize(framePointer + sizeof(frameHeader));
+        memcpy(file.data() + framePointer, &frameHeader, sizeof(frameHeader));
+        file.insert(file.end(), frameData.begin(), frameData.end());
+    }
+    WorldStone::ThreadPool threadPool{2};
+
+    for (bool withViews : {true, false})
+    {
+        CAPTURE(withViews);
+        DC6             dc6;
+        Vector<uint8_t> fileCopy = file;
+        if (withViews)
+            REQUIRE(dc6.initDecoder(std::make_unique<MemoryStream>(std::move(fileCopy))));
+        else
+            REQUIRE(dc6.initDecoder(std::make_unique<NoViewStream>(std::move(fileCopy))));
+
+        DirtyImageProvider imgProvider;
+        REQUIRE(dc6.decompressAll(imgProvider, threadPool));
+        REQUIRE(imgProvider.getImagesNumber() == 4);
+        for (size_t frame = 0; frame < 4; frame++)
+        {
+            const WorldStone::ImageView<const uint8_t> image = imgProvider.getImage(frame);
+            const Vector<uint8_t>                      expected = dc6.decompressFrame(frame);
+            REQUIRE(image.width == size_t(sizes[frame][0]));
+            REQUIRE(image.height == size_t(sizes[frame][1]));
+            CHECK(memcmp(image.buffer, expected.data(), expected.size()) == 0);
+        }
+    }
+    SUBCASE("Invalid frames are reported")
+    {
+        Vector<uint8_t> invalidFile = makeDC6File({0x83, 0x02, 'a', 'b'});
+        DC6             dc6;
+        REQUIRE(dc6.initDecoder(std::make_unique<MemoryStream>(std::move(invalidFile))));
+        DirtyImageProvider imgProvider;
+        CHECK_FALSE(dc6.decompressAll(imgProvider, threadPool));
+    }
+}
@@ -7,10 +7,12 @@
 #include <SystemUtils.h>
 #include <doctest.h>
 #include "ImageView.h"
+#include "SlabImageProvider.h"
 
 using WorldStone::Vector;
 using WorldStone::ImageView;
 using WorldStone::SimpleImageProvider;
+using WorldStone::SlabImageProvider;
 
 static_assert(std::is_copy_constructible<ImageView<uint8_t>>::value,
               "Image view copy must be possible");
@@ -93,6 +95,67 @@ TEST_CASE("ImageView")
     }
 }
 
+/// @testimpl{WorldStone::ImageView,ImageView_CopyFillBlit}
+TEST_CASE("ImageView copy, fill and blit")
+{
+    // Odd sizes and strides, so that the vectorized loops have remainders
+    const size_t    width = 45, height = 7, stride = 50;
+    Vector<uint8_t> sourceBuffer(stride * height);
+    for (size_t i = 0; i < sourceBuffer.size(); i++)
+    {
+        sourceBuffer[i] = i % 3 == 0 ? 0 : uint8_t(i);
+    }
+    const ImageView<uint8_t> source{sourceBuffer.data(), width, height, stride};
+    Vector<uint8_t>          destinationBuffer(stride * height);
+    ImageView<uint8_t>       destination{destinationBuffer.data(), width, height, stride};
+
+    SUBCASE("fill")
+    {
+        destination.fill(3, 2, 40, 4, 9);
+        for (size_t y = 0; y < height; y++)
+        {
+            for (size_t x = 0; x < stride; x++)
+            {
+                const bool filled = x >= 3 && x < 43 && y >= 2 && y < 6;
+                CHECK(destinationBuffer[x + y * stride] == (filled ? 9 : 0));
+            }
+        }
+    }
+    SUBCASE("copyTo")
+    {
+        source.copyTo(destination);
+        for (size_t y = 0; y < height; y++)
+        {
+            CHECK(memcmp(&destination(0, y), &source(0, y), width) == 0);
+            CHECK(destination(width, y) == 0); // Padding is untouched
+        }
+        // Contiguous images
+        Vector<uint8_t>          contiguousBuffer(width * height);
+        const ImageView<uint8_t> contiguous{contiguousBuffer.data(), width, height, width};
+        source.copyTo(contiguous);
+        contiguous.copyTo(ImageView<uint8_t>{destinationBuffer.data(), width, height, width});
+        CHECK(memcmp(destinationBuffer.data(), contiguousBuffer.data(), width * height) == 0);
+    }
+    SUBCASE("blitTransparent")
+    {
+        for (const uint8_t key : {uint8_t(0), uint8_t(7)})
+        {
+            CAPTURE(int(key));
+            destination.fillBytes(0, 0, stride, height, 0xFF);
+            WorldStone::blitTransparent(source, destination, key);
+            for (size_t y = 0; y < height; y++)
+            {
+                for (size_t x = 0; x < stride; x++)
+                {
+                    const bool    inside   = x < width;
+                    const uint8_t expected = inside && source(x, y) != key ? source(x, y) : 0xFF;
+                    CHECK(destinationBuffer[x + y * stride] == expected);
+                }
+            }
+        }
+    }
+}
+
 TEST_CASE("SimpleImageViewProvider")
 {
     SimpleImageProvider<uint8_t> imageProvider;
@@ -128,3 +191,64 @@ TEST_CASE("SimpleImageViewProvider")
         CHECK(imageProvider.getImagesNumber() == 0);
     }
 }
+
+/// @testimpl{WorldStone::SlabImageProvider,SlabImageProvider}
+TEST_CASE("SlabImageProvider")
+{
+    SlabImageProvider<uint8_t> imageProvider{1000};
+    CHECK(imageProvider.getImagesNumber() == 0);
+    CHECK(imageProvider.getSlabsNumber() == 0);
+    SUBCASE("Images are allocated one after the other in the same slab")
+    {
+        const ImageView<uint8_t> first  = imageProvider.getNewImage(10, 20);
+        const ImageView<uint8_t> second = imageProvider.getNewImage(30, 10);
+        REQUIRE(first.isValid());
+        REQUIRE(second.isValid());
+        CHECK(second.width == 30);
+        CHECK(second.height == 10);
+        CHECK(second.stride == 30);
+        CHECK(second.buffer == first.buffer + 10 * 20);
+        CHECK(imageProvider.getSlabsNumber() == 1);
+        REQUIRE(imageProvider.getImagesNumber() == 2);
+        CHECK(imageProvider.getImage(1) == second);
+        CHECK(second(29, 9) == 0);
+
+        // Does not fit in the remaining 500 pixels
+        const ImageView<uint8_t> third = imageProvider.getNewImage(30, 20);
+        CHECK(third.isValid());
+        CHECK(imageProvider.getSlabsNumber() == 2);
+        // Images bigger than the slabs get a slab of their size
+        CHECK(imageProvider.getNewImage(100, 100).isValid());
+        CHECK(imageProvider.getSlabsNumber() == 3);
+    }
+    SUBCASE("Reserving makes the next images use the same slab")
+    {
+        imageProvider.getNewImage(10, 10);
+        imageProvider.reserve(3, 3000);
+        CHECK(imageProvider.getSlabsNumber() == 2);
+        const ImageView<uint8_t> first = imageProvider.getNewImage(20, 50);
+        CHECK(imageProvider.getNewImage(20, 50).buffer == first.buffer + 1000);
+        CHECK(imageProvider.getNewImage(10, 100).buffer == first.buffer + 2000);
+        CHECK(imageProvider.getSlabsNumber() == 2);
+        // Nothing to do if there is enough space left
+        imageProvider.reserve(0, 0);
+        CHECK(imageProvider.getSlabsNumber() == 2);
+    }
+    SUBCASE("Moved images keep their slab alive")
+    {
+        ImageView<uint8_t> image = imageProvider.getNewImage(4, 4);
+        image.fillBytes(0, 0, 4, 4, 7);
+        SlabImageProvider<uint8_t>::ImageBuffer moved = imageProvider.moveImageBuffer(0);
+        CHECK(moved.image == image);
+        CHECK(!imageProvider.getImage(0).isValid());
+        CHECK(!imageProvider.moveImageBuffer(0).image.isValid());
+        imageProvider = SlabImageProvider<uint8_t>{};
+        CHECK(moved.image(3, 3) == 7);
+    }
+    SUBCASE("Asking for an image of invalid dimensions returns invalid ImageView")
+    {
+        CHECK(!imageProvider.getNewImage(256, 0).isValid());
+        CHECK(!imageProvider.getNewImage(0, 256).isValid());
+        CHECK(imageProvider.getImagesNumber() == 0);
+    }
+}
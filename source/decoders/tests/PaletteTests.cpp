@@ -0,0 +1,101 @@
+/**
+ * @file PaletteTests.cpp
+ */
+#include <MemoryStream.h>
+#include <palette.h>
+#include "doctest.h"
+
+using WorldStone::ImageView;
+using WorldStone::MemoryStream;
+using WorldStone::Palette;
+using WorldStone::Vector;
+
+namespace
+{
+/// Generates a palette file where the color of each index is (index, 255 - index, index / 2)
+Vector<uint8_t> makePaletteFile()
+{
+    Vector<uint8_t> file;
+    for (int i = 0; i < Palette::colorCount; i++)
+    {
+        // Stored as BGR
+        file.push_back(uint8_t(i / 2));
+        file.push_back(uint8_t(255 - i));
+        file.push_back(uint8_t(i));
+    }
+    return file;
+}
+} // anonymous namespace
+
+/// @testimpl{WorldStone::Palette,Palette}
+TEST_CASE("Palette decoding")
+{
+    Palette      palette;
+    MemoryStream stream{makePaletteFile()};
+    palette.decode(&stream);
+    REQUIRE(palette.isValid());
+
+    SUBCASE("Colors are read in the BGR order")
+    {
+        CHECK(palette.colors[42].r == 42);
+        CHECK(palette.colors[42].g == 255 - 42);
+        CHECK(palette.colors[42].b == 21);
+    }
+    SUBCASE("Packed colors")
+    {
+        const uint8_t* rgba = reinterpret_cast<const uint8_t*>(&palette.getRGBA32()[42]);
+        CHECK(rgba[0] == 42);
+        CHECK(rgba[1] == 255 - 42);
+        CHECK(rgba[2] == 21);
+        CHECK(rgba[3] == 255);
+        const uint8_t* bgra = reinterpret_cast<const uint8_t*>(&palette.getBGRA32()[42]);
+        CHECK(bgra[0] == 21);
+        CHECK(bgra[1] == 255 - 42);
+        CHECK(bgra[2] == 42);
+        CHECK(bgra[3] == 255);
+        // Index 0 is transparent
+        CHECK(reinterpret_cast<const uint8_t*>(&palette.getRGBA32()[0])[3] == 0);
+    }
+    SUBCASE("Truncated palettes are invalid")
+    {
+        Vector<uint8_t> truncatedFile = makePaletteFile();
+        truncatedFile.pop_back();
+        MemoryStream truncatedStream{std::move(truncatedFile)};
+        Palette      truncatedPalette;
+        truncatedPalette.decode(&truncatedStream);
+        CHECK_FALSE(truncatedPalette.isValid());
+    }
+}
+
+/// @testimpl{WorldStone::Palette,Palette}
+TEST_CASE("Expand indexed images to RGBA")
+{
+    Palette      palette;
+    MemoryStream stream{makePaletteFile()};
+    palette.decode(&stream);
+    REQUIRE(palette.isValid());
+
+    // Odd sizes to test both the vectorized loop and the remaining pixels
+    const size_t    width = 37, height = 5, destinationStride = 41;
+    Vector<uint8_t> indices(width * height);
+    for (size_t i = 0; i < indices.size(); i++)
+    {
+        indices[i] = uint8_t(i * 7);
+    }
+    const uint32_t      guardValue = 0xDEADBEEF;
+    Vector<uint32_t>    pixels(destinationStride * height, guardValue);
+    ImageView<uint32_t> destination{pixels.data(), width, height, destinationStride};
+    palette.expandIndexedToRGBA({indices.data(), width, height, width}, destination);
+
+    bool allPixelsMatch = true;
+    for (size_t y = 0; y < height; y++)
+    {
+        for (size_t x = 0; x < destinationStride; x++)
+        {
+            const uint32_t expected =
+                x < width ? palette.getRGBA32()[indices[x + y * width]] : guardValue;
+            allPixelsMatch &= destination(x, y) == expected;
+        }
+    }
+    CHECK(allPixelsMatch);
+}
@@ -0,0 +1,166 @@
+/**
+ * @file SpriteCacheTests.cpp
+ */
+#include <FileStream.h>
+#include <SpriteCache.h>
+#include <ThreadPool.h>
+#include <dcc.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+#include "doctest.h"
+
+using WorldStone::DCC;
+using WorldStone::FileStream;
+using WorldStone::SpriteCache;
+using WorldStone::ThreadPool;
+using WorldStone::Vector;
+
+namespace
+{
+/// Creates frames made of a single image of the given size
+SpriteCache::FramesPtr makeFrames(size_t sizeInBytes)
+{
+    auto frames = std::make_shared<SpriteCache::Frames>();
+    frames->images.push_back(frames->storage.getNewImage(sizeInBytes, 1));
+    return frames;
+}
+} // anonymous namespace
+
+/// @testimpl{WorldStone::SpriteCache,SpriteCache}
+TEST_CASE("SpriteCache eviction")
+{
+    SpriteCache cache{250};
+    int         loadsCount = 0;
+    auto        loader     = [&loadsCount] {
+        loadsCount++;
+        return makeFrames(100);
+    };
+    const SpriteCache::Key keyA{nullptr, "a.dcc", 0};
+    const SpriteCache::Key keyB{nullptr, "a.dcc", 1}; // Same file, other direction
+    const SpriteCache::Key keyC{nullptr, "c.dcc", 0};
+
+    SpriteCache::FramesPtr framesA = cache.get(keyA, loader);
+    REQUIRE(framesA);
+    CHECK(cache.get(keyA, loader) == framesA);
+    CHECK(loadsCount == 1);
+    // Paths are compared regardless of the case and separators
+    CHECK(cache.get({nullptr, "A.DCC", 0}, loader) == framesA);
+    const SpriteCache::Key keyWithSlashes{nullptr, "Data/a.dcc", 0};
+    CHECK(keyWithSlashes == SpriteCache::Key{nullptr, "data\\A.dcc", 0});
+    CHECK(loadsCount == 1);
+    cache.get(keyB, loader);
+    CHECK(loadsCount == 2);
+    CHECK(cache.getMemoryUsage() == 200);
+
+    cache.get(keyA, loader); // A is now more recently used than B
+    cache.get(keyC, loader);
+    CHECK(loadsCount == 3);
+    CHECK(cache.getEntriesCount() == 2);
+    CHECK(cache.getMemoryUsage() == 200);
+
+    // B was evicted, but not A nor C
+    cache.get(keyA, loader);
+    cache.get(keyC, loader);
+    CHECK(loadsCount == 3);
+    cache.get(keyB, loader);
+    CHECK(loadsCount == 4);
+
+    SUBCASE("Lowering the budget evicts entries")
+    {
+        cache.setBudget(100);
+        CHECK(cache.getEntriesCount() == 1);
+        CHECK(cache.getMemoryUsage() == 100);
+    }
+    SUBCASE("Clearing the cache")
+    {
+        cache.clear();
+        CHECK(cache.getEntriesCount() == 0);
+        CHECK(cache.getMemoryUsage() == 0);
+        // Frames still held by the user are still valid
+        CHECK(framesA->images[0].width == 100);
+    }
+}
+
+/// @testimpl{WorldStone::SpriteCache,SpriteCache}
+TEST_CASE("SpriteCache failures are not cached")
+{
+    SpriteCache            cache{1000};
+    const SpriteCache::Key key{nullptr, "a.dcc", 0};
+    int                    loadsCount = 0;
+
+    CHECK(cache.get(key, [&] {
+        loadsCount++;
+        return SpriteCache::FramesPtr{};
+    }) == nullptr);
+    CHECK(cache.getEntriesCount() == 0);
+
+    CHECK_THROWS_AS(cache.get(key,
+                              [&]() -> SpriteCache::FramesPtr {
+                                  loadsCount++;
+                                  throw std::runtime_error("Decoding failed");
+                              }),
+                    std::runtime_error);
+    CHECK(cache.getEntriesCount() == 0);
+
+    CHECK(cache.get(key, [&] {
+        loadsCount++;
+        return makeFrames(10);
+    }) != nullptr);
+    CHECK(loadsCount == 3);
+    CHECK(cache.getEntriesCount() == 1);
+}
+
+/// @testimpl{WorldStone::SpriteCache,SpriteCache}
+TEST_CASE("SpriteCache concurrent requests share the same decode")
+{
+    SpriteCache            cache{1000};
+    const SpriteCache::Key key{nullptr, "a.dcc", 0};
+    std::atomic<int>       loadsCount{0};
+    auto                   slowLoader = [&] {
+        loadsCount++;
+        std::this_thread::sleep_for(std::chrono::milliseconds(50));
+        return makeFrames(10);
+    };
+
+    ThreadPool                     pool{4};
+    Vector<SpriteCache::FramesPtr> results(8);
+    pool.parallelFor(results.size(),
+                     [&](size_t index) { results[index] = cache.get(key, slowLoader); });
+    CHECK(loadsCount == 1);
+    REQUIRE(results[0] != nullptr);
+    for (const SpriteCache::FramesPtr& frames : results)
+    {
+        CHECK(frames == results[0]);
+    }
+}
+
+/// @testimpl{WorldStone::SpriteCache,SpriteCache}
+TEST_CASE("SpriteCache decoding helpers")
+{
+    const char*    fileName = "HZTRLITA1HTH.dcc";
+    const uint32_t dirIndex = 3;
+    const auto     frames =
+        SpriteCache::decodeDCCDirection(std::make_unique<FileStream>(fileName), dirIndex);
+    REQUIRE(frames != nullptr);
+
+    DCC dcc;
+    REQUIRE(dcc.initDecoder(std::make_unique<FileStream>(fileName)));
+    DCC::Direction                           dir;
+    WorldStone::SimpleImageProvider<uint8_t> imgProvider;
+    REQUIRE(dcc.readDirection(dir, dirIndex, imgProvider));
+    REQUIRE(frames->images.size() == imgProvider.getImagesNumber());
+    for (size_t frame = 0; frame < frames->images.size(); frame++)
+    {
+        const auto cached   = frames->images[frame];
+        const auto expected = imgProvider.getImage(frame);
+        REQUIRE(cached.width == expected.width);
+        REQUIRE(cached.height == expected.height);
+        CHECK(memcmp(cached.buffer, expected.buffer, cached.width * cached.height) == 0);
+    }
+
+    CHECK(SpriteCache::decodeDCCDirection(std::make_unique<FileStream>(fileName), 200) == nullptr);
+    CHECK(SpriteCache::decodeDCCDirection(std::make_unique<FileStream>("missing.dcc"), 0) ==
+          nullptr);
+}
@@ -3,11 +3,32 @@
  * @brief Implementation of the tests for the various file decoders.
  */
 #define DOCTEST_CONFIG_IMPLEMENT_WITH_MAIN
+#include <MmapFileStream.h>
+#include <ThreadPool.h>
 #include <dcc.h>
+#include <stdlib.h>
+#include <atomic>
+#include <new>
+#include <set>
 #include "doctest.h"
 using WorldStone::DCC;
 using WorldStone::SimpleImageProvider;
 using WorldStone::FileStream;
+using WorldStone::ImageView;
+using WorldStone::MmapFileStream;
+using WorldStone::ThreadPool;
+using WorldStone::Vector;
+
+/// Checks that two images have the same dimensions and content
+static bool sameImageContent(ImageView<const uint8_t> lhs, ImageView<const uint8_t> rhs)
+{
+    if (lhs.width != rhs.width || lhs.height != rhs.height) return false;
+    for (size_t y = 0; y < lhs.height; y++)
+    {
+        if (memcmp(&lhs(0, y), &rhs(0, y), lhs.width) != 0) return false;
+    }
+    return true;
+}
 
 /**Try to decode BaalSpirit.dcc.
  * This is the DCC file with the biggest number of frames (but only 1 direction).
@@ -206,3 +227,388 @@ TEST_CASE("DCC decoding HZTRLITA1HTH.dcc")
     CHECK(dir.extents.height() ==      62);
     // clang-format on
 }
+
+/**@testimpl{WorldStone::DCC,DCC_AllDirections}
+ * Decoding all the directions in parallel must give the same result as decoding them one by one.
+ */
+TEST_CASE("DCC parallel decoding of all directions")
+{
+    using ImgProvider = SimpleImageProvider<uint8_t>;
+    ThreadPool  threadPool{4};
+    const char* fileName = "CRHDBRVDTHTH.dcc";
+
+    DCC serialDcc;
+    REQUIRE(serialDcc.initDecoder(std::make_unique<FileStream>(fileName)));
+    const size_t           nbDirs = serialDcc.getHeader().directions;
+    Vector<DCC::Direction> serialDirs(nbDirs);
+    Vector<ImgProvider>    serialProviders(nbDirs);
+    for (uint32_t dirIndex = 0; dirIndex < nbDirs; dirIndex++)
+    {
+        REQUIRE(serialDcc.readDirection(serialDirs[dirIndex], dirIndex, serialProviders[dirIndex]));
+    }
+
+    DCC parallelDcc;
+    REQUIRE(parallelDcc.initDecoder(std::make_unique<FileStream>(fileName)));
+    Vector<DCC::Direction> parallelDirs;
+    Vector<ImgProvider>    parallelProviders(nbDirs);
+    const auto providerFactory = [&](uint32_t dirIndex) -> ImgProvider& {
+        return parallelProviders[dirIndex];
+    };
+    REQUIRE(parallelDcc.readAllDirections(parallelDirs, threadPool, providerFactory));
+    REQUIRE(parallelDirs.size() == nbDirs);
+
+    for (size_t dirIndex = 0; dirIndex < nbDirs; dirIndex++)
+    {
+        CHECK(parallelDirs[dirIndex].extents.xLower == serialDirs[dirIndex].extents.xLower);
+        CHECK(parallelDirs[dirIndex].extents.yLower == serialDirs[dirIndex].extents.yLower);
+        CHECK(parallelDirs[dirIndex].extents.xUpper == serialDirs[dirIndex].extents.xUpper);
+        CHECK(parallelDirs[dirIndex].extents.yUpper == serialDirs[dirIndex].extents.yUpper);
+        const ImgProvider& serialImgs   = serialProviders[dirIndex];
+        const ImgProvider& parallelImgs = parallelProviders[dirIndex];
+        REQUIRE(parallelImgs.getImagesNumber() == serialImgs.getImagesNumber());
+        for (size_t frame = 0; frame < serialImgs.getImagesNumber(); frame++)
+        {
+            CHECK(sameImageContent(parallelImgs.getImage(frame), serialImgs.getImage(frame)));
+        }
+    }
+}
+
+/**@testimpl{WorldStone::DCC,DCC_ParallelFrames}
+ * Decoding the frames of a direction concurrently must give the same result as decoding them in
+ * order. Equal cells are copied from the previous frames, which must be done in order.
+ */
+TEST_CASE("DCC parallel decoding of the frames of a direction")
+{
+    using ImgProvider = SimpleImageProvider<uint8_t>;
+    ThreadPool threadPool{4};
+    for (const char* fileName : {"BaalSpirit.dcc", "HZTRLITA1HTH.dcc", "BloodSmall01.dcc"})
+    {
+        CAPTURE(fileName);
+        DCC dcc;
+        REQUIRE(dcc.initDecoder(std::make_unique<FileStream>(fileName)));
+        for (uint32_t dirIndex = 0; dirIndex < dcc.getHeader().directions; dirIndex++)
+        {
+            DCC::Direction serialDir, parallelDir;
+            ImgProvider    serialImgs, parallelImgs;
+            REQUIRE(dcc.readDirection(serialDir, dirIndex, serialImgs));
+            REQUIRE(dcc.readDirection(parallelDir, dirIndex, parallelImgs, threadPool));
+            REQUIRE(parallelImgs.getImagesNumber() == serialImgs.getImagesNumber());
+            for (size_t frame = 0; frame < serialImgs.getImagesNumber(); frame++)
+            {
+                CHECK(sameImageContent(parallelImgs.getImage(frame), serialImgs.getImage(frame)));
+            }
+        }
+    }
+}
+
+/**@testimpl{WorldStone::DCC,DCC_DirectionDecoder}
+ * Decoding the frames one at a time must give the same result as decoding the whole direction.
+ */
+TEST_CASE("DCC decoding of the frames one at a time")
+{
+    const char* fileName = "HZTRLITA1HTH.dcc";
+    DCC         dcc;
+    REQUIRE(dcc.initDecoder(std::make_unique<FileStream>(fileName)));
+    const uint32_t dirIndex = 3;
+
+    DCC::Direction               dir;
+    SimpleImageProvider<uint8_t> imgProvider;
+    REQUIRE(dcc.readDirection(dir, dirIndex, imgProvider));
+
+    DCC::DirectionDecoder decoder;
+    CHECK_FALSE(decoder.hasNextFrame());
+    CHECK_FALSE(decoder.initDecoder(dcc, dcc.getHeader().directions));
+    REQUIRE(decoder.initDecoder(dcc, dirIndex));
+    REQUIRE(decoder.getDirection().frameHeaders.size() == imgProvider.getImagesNumber());
+    CHECK(decoder.getDirection().extents.width() == dir.extents.width());
+    CHECK(decoder.getDirection().extents.height() == dir.extents.height());
+
+    // A single buffer big enough for any frame of the direction
+    const size_t    stride = size_t(dir.extents.width());
+    Vector<uint8_t> frameBuffer(stride * size_t(dir.extents.height()));
+    const auto      decodeAllFrames = [&]() {
+        for (size_t frame = 0; frame < imgProvider.getImagesNumber(); frame++)
+        {
+            REQUIRE(decoder.hasNextFrame());
+            REQUIRE(decoder.getNextFrameIndex() == frame);
+            const ImageView<const uint8_t> expected = imgProvider.getImage(frame);
+            const ImageView<uint8_t> frameImage{frameBuffer.data(), expected.width, expected.height,
+                                                stride};
+            REQUIRE(decoder.decodeNextFrame(frameImage));
+            CHECK(sameImageContent(frameImage, expected));
+        }
+        CHECK_FALSE(decoder.hasNextFrame());
+        CHECK_FALSE(decoder.decodeNextFrame({frameBuffer.data(), stride, 1, stride}));
+    };
+    decodeAllFrames();
+
+    SUBCASE("Looping")
+    {
+        decoder.rewind();
+        CHECK(decoder.getNextFrameIndex() == 0);
+        decodeAllFrames();
+    }
+    SUBCASE("The buffer must be big enough for the frame")
+    {
+        decoder.rewind();
+        const DCC::FrameHeader& frameHeader = decoder.getDirection().frameHeaders[0];
+        const size_t            width       = size_t(frameHeader.extents.width());
+        CHECK_FALSE(decoder.decodeNextFrame({frameBuffer.data(), width - 1, 1, stride}));
+        CHECK(decoder.getNextFrameIndex() == 0);
+    }
+}
+
+/// A stream that counts the number of bytes read from a file
+class ReadCountingStream : public WorldStone::IStream
+{
+    FileStream file;
+
+public:
+    size_t bytesRead = 0;
+
+    explicit ReadCountingStream(const char* fileName) : file(fileName) {}
+
+    long   size() override { return file.size(); }
+    long   tell() override { return file.tell(); }
+    bool   seek(long offset, seekdir origin) override { return file.seek(offset, origin); }
+    size_t read(void* buffer, size_t size) override
+    {
+        const size_t readSize = file.read(buffer, size);
+        bytesRead += readSize;
+        if (!file.good()) setstate(file.eof() ? eofbit | failbit : failbit);
+        return readSize;
+    }
+};
+
+/**@testimpl{WorldStone::DCC,DCC_DirectionHeaders}
+ * Reading only the headers must give the same information as decoding the direction, while only
+ * reading the beginning of the direction.
+ */
+TEST_CASE("DCC reading of the direction headers only")
+{
+    for (const char* fileName : {"BaalSpirit.dcc", "CRHDBRVDTHTH.dcc", "BloodSmall01.dcc"})
+    {
+        CAPTURE(fileName);
+        DCC                 dcc;
+        auto                countingStream = std::make_unique<ReadCountingStream>(fileName);
+        ReadCountingStream& counter        = *countingStream;
+        REQUIRE(dcc.initDecoder(std::move(countingStream)));
+        DCC::Direction invalidDir;
+        CHECK_FALSE(dcc.readDirectionHeaders(invalidDir, dcc.getHeader().directions));
+
+        for (uint32_t dirIndex = 0; dirIndex < dcc.getHeader().directions; dirIndex++)
+        {
+            DCC::Direction headersOnly;
+            counter.bytesRead = 0;
+            REQUIRE(dcc.readDirectionHeaders(headersOnly, dirIndex));
+            const size_t headersBytesRead = counter.bytesRead;
+
+            DCC::Direction               decoded;
+            SimpleImageProvider<uint8_t> imgProvider;
+            counter.bytesRead = 0;
+            REQUIRE(dcc.readDirection(decoded, dirIndex, imgProvider));
+            // Only the headers are read, which are a small part of the direction
+            CHECK(headersBytesRead * 4 < counter.bytesRead);
+
+            CHECK(headersOnly.header.outsizeCoded == decoded.header.outsizeCoded);
+            CHECK(headersOnly.header.compressEqualCells == decoded.header.compressEqualCells);
+            CHECK(headersOnly.extents.xLower == decoded.extents.xLower);
+            CHECK(headersOnly.extents.yLower == decoded.extents.yLower);
+            CHECK(headersOnly.extents.xUpper == decoded.extents.xUpper);
+            CHECK(headersOnly.extents.yUpper == decoded.extents.yUpper);
+            REQUIRE(headersOnly.frameHeaders.size() == decoded.frameHeaders.size());
+            for (size_t frame = 0; frame < decoded.frameHeaders.size(); frame++)
+            {
+                const DCC::FrameHeader& lhs = headersOnly.frameHeaders[frame];
+                const DCC::FrameHeader& rhs = decoded.frameHeaders[frame];
+                CHECK(lhs.width == rhs.width);
+                CHECK(lhs.height == rhs.height);
+                CHECK(lhs.xOffset == rhs.xOffset);
+                CHECK(lhs.yOffset == rhs.yOffset);
+                CHECK(lhs.codedBytes == rhs.codedBytes);
+            }
+        }
+    }
+}
+
+/// Number of calls to the global operator new, used to check that decoding does not allocate
+static std::atomic<size_t> allocationsCount{0};
+
+void* operator new(size_t size)
+{
+    allocationsCount++;
+    if (void* ptr = malloc(size ? size : 1)) return ptr;
+    throw std::bad_alloc{};
+}
+void operator delete(void* ptr) noexcept { free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { free(ptr); }
+
+/// Provides the images from a single buffer, so that it does not allocate
+class BufferImageProvider : public WorldStone::IImageProvider<uint8_t>
+{
+    Vector<uint8_t> buffer;
+    size_t          usedSize = 0;
+
+public:
+    explicit BufferImageProvider(size_t bufferSize) : buffer(bufferSize) {}
+
+    ImageView<uint8_t> getNewImage(size_t width, size_t height) override
+    {
+        if (usedSize + width * height > buffer.size()) return {};
+        ImageView<uint8_t> image{buffer.data() + usedSize, width, height, width};
+        usedSize += width * height;
+        return image;
+    }
+    void reset() { usedSize = 0; }
+};
+
+/**@testimpl{WorldStone::DCC,DCC_DecodeContext}
+ * Decoding with a context that was used for other directions must give the same result, and
+ * should not allocate memory anymore.
+ */
+TEST_CASE("DCC decoding with a reused context")
+{
+    DCC dcc;
+    REQUIRE(dcc.initDecoder(std::make_unique<FileStream>("HZTRLITA1HTH.dcc")));
+    const uint32_t dirIndex = 5;
+
+    DCC::Direction               expectedDir;
+    SimpleImageProvider<uint8_t> expectedImgs;
+    REQUIRE(dcc.readDirection(expectedDir, dirIndex, expectedImgs));
+    size_t imagesSize = 0;
+    for (size_t frame = 0; frame < expectedImgs.getImagesNumber(); frame++)
+    {
+        imagesSize += expectedImgs.getImage(frame).width * expectedImgs.getImage(frame).height;
+    }
+
+    DCC::DecodeContext context;
+    {
+        // Use the context for a bigger direction of another file first
+        DCC otherDcc;
+        REQUIRE(otherDcc.initDecoder(std::make_unique<FileStream>("BaalSpirit.dcc")));
+        DCC::Direction               otherDir;
+        SimpleImageProvider<uint8_t> otherImgs;
+        REQUIRE(otherDcc.readDirection(otherDir, 0, otherImgs, context));
+    }
+
+    DCC::Direction      dir;
+    BufferImageProvider imgProvider{imagesSize};
+    REQUIRE(dcc.readDirection(dir, dirIndex, imgProvider, context));
+
+    imgProvider.reset();
+    size_t allocationsBefore = allocationsCount;
+    REQUIRE(dcc.readDirection(dir, dirIndex, imgProvider));
+    CHECK(size_t(allocationsCount) > allocationsBefore); // Uses a new context
+
+    imgProvider.reset();
+    allocationsBefore  = allocationsCount;
+    const bool success = dcc.readDirection(dir, dirIndex, imgProvider, context);
+    CHECK(size_t(allocationsCount) == allocationsBefore);
+    REQUIRE(success);
+
+    imgProvider.reset();
+    for (size_t frame = 0; frame < expectedImgs.getImagesNumber(); frame++)
+    {
+        const ImageView<const uint8_t> expected = expectedImgs.getImage(frame);
+        CHECK(sameImageContent(imgProvider.getNewImage(expected.width, expected.height), expected));
+    }
+
+    context.releaseMemory();
+    REQUIRE(dcc.readDirection(dir, dirIndex, expectedImgs, context));
+}
+
+/**@testimpl{WorldStone::DCC,DCC_MemoryMapped}
+ * Decoding directly from a memory mapped file must give the same result as decoding from a copy.
+ */
+TEST_CASE("DCC decoding from a memory mapped file")
+{
+    using ImgProvider    = SimpleImageProvider<uint8_t>;
+    const char* fileName = "HZTRLITA1HTH.dcc";
+
+    DCC fileDcc;
+    REQUIRE(fileDcc.initDecoder(std::make_unique<FileStream>(fileName)));
+    DCC mappedDcc;
+    REQUIRE(mappedDcc.initDecoder(std::make_unique<MmapFileStream>(fileName)));
+    REQUIRE(mappedDcc.getHeader().directions == fileDcc.getHeader().directions);
+
+    for (uint32_t dirIndex = 0; dirIndex < fileDcc.getHeader().directions; dirIndex++)
+    {
+        DCC::Direction fileDir, mappedDir;
+        ImgProvider    fileImgs, mappedImgs;
+        REQUIRE(fileDcc.readDirection(fileDir, dirIndex, fileImgs));
+        REQUIRE(mappedDcc.readDirection(mappedDir, dirIndex, mappedImgs));
+        REQUIRE(mappedImgs.getImagesNumber() == fileImgs.getImagesNumber());
+        for (size_t frame = 0; frame < fileImgs.getImagesNumber(); frame++)
+        {
+            CHECK(sameImageContent(mappedImgs.getImage(frame), fileImgs.getImage(frame)));
+        }
+    }
+}
+
+/**@testimpl{WorldStone::DCC,DCC_BlockDictionary}
+ * Drawing the blocks of each frame must give the decoded frames, while storing less pixels.
+ */
+TEST_CASE("DCC decoding as a dictionary of blocks")
+{
+    using BlockDictionary = DCC::BlockDictionary;
+    const size_t blockSize = BlockDictionary::blockSize;
+    for (const char* fileName : {"BaalSpirit.dcc", "CRHDBRVDTHTH.dcc", "HZTRLITA1HTH.dcc"})
+    {
+        CAPTURE(fileName);
+        DCC dcc;
+        REQUIRE(dcc.initDecoder(std::make_unique<FileStream>(fileName)));
+        DCC::Direction  invalidDir;
+        BlockDictionary dictionary;
+        CHECK_FALSE(dcc.readDirection(invalidDir, dcc.getHeader().directions, dictionary));
+
+        DCC::DecodeContext context;
+        for (uint32_t dirIndex = 0; dirIndex < dcc.getHeader().directions; dirIndex++)
+        {
+            CAPTURE(dirIndex);
+            DCC::Direction               expectedDir;
+            SimpleImageProvider<uint8_t> expectedImgs;
+            REQUIRE(dcc.readDirection(expectedDir, dirIndex, expectedImgs));
+
+            DCC::Direction dir;
+            REQUIRE(dcc.readDirection(dir, dirIndex, dictionary, context));
+            REQUIRE(dictionary.getFramesNumber() == expectedImgs.getImagesNumber());
+
+            size_t framesPixels = 0;
+            for (size_t frame = 0; frame < dictionary.getFramesNumber(); frame++)
+            {
+                const ImageView<const uint8_t> expected = expectedImgs.getImage(frame);
+                framesPixels += expected.width * expected.height;
+
+                // Draw the blocks in an image with a margin, as they can overflow the frame
+                const WorldStone::AABB<int32_t>& frameExtents = dir.frameHeaders[frame].extents;
+                const size_t    offsetX = size_t(frameExtents.xLower - dir.extents.xLower);
+                const size_t    offsetY = size_t(frameExtents.yLower - dir.extents.yLower);
+                const size_t    stride  = expected.width + 2 * blockSize;
+                Vector<uint8_t> pixels(stride * (expected.height + 2 * blockSize), 0);
+                const ImageView<uint8_t> canvas{pixels.data(), stride,
+                                                expected.height + 2 * blockSize, stride};
+                for (auto blockRef = dictionary.frameBegin(frame);
+                     blockRef != dictionary.frameEnd(frame); ++blockRef)
+                {
+                    REQUIRE(blockRef->blockIndex < dictionary.blocks.size());
+                    const BlockDictionary::Block& block = dictionary.blocks[blockRef->blockIndex];
+                    const size_t blockX = blockRef->cellX * blockSize + blockSize - offsetX;
+                    const size_t blockY = blockRef->cellY * blockSize + blockSize - offsetY;
+                    for (size_t y = 0; y < blockSize; y++)
+                    {
+                        memcpy(&canvas(blockX, blockY + y), &block[y * blockSize], blockSize);
+                    }
+                }
+                CHECK(sameImageContent(
+                    canvas.subView(blockSize, blockSize, expected.width, expected.height),
+                    expected));
+            }
+            // Blocks are stored only once, and the transparent ones are omitted
+            std::set<BlockDictionary::Block> uniqueBlocks(dictionary.blocks.begin(),
+                                                          dictionary.blocks.end());
+            CHECK(uniqueBlocks.size() == dictionary.blocks.size());
+            CHECK(uniqueBlocks.count(BlockDictionary::Block{}) == 0);
+            CHECK(dictionary.blocks.size() * blockSize * blockSize < framesPixels);
+        }
+    }
+}
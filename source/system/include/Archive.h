@@ -3,6 +3,7 @@
 //
 #pragma once
 
+#include <vector>
 #include "IOBase.h"
 #include "Stream.h"
 
@@ -37,5 +38,21 @@ public:
     virtual bool exists(const path& filePath)    = 0;
     virtual StreamPtr open(const path& filePath) = 0;
     virtual bool isThreadSafe() { return false; }
+
+    /**Enumerate the files of the archive, if the implementation supports it.
+     * @param files The paths of the files are appended to this list, and can be given to @ref open
+     * @return true if the list is known to be complete. MPQ archives for example only know the
+     *         names of the files given by their list files. The default implementation returns
+     *         false without adding anything.
+     */
+    virtual bool listFiles(std::vector<path>& files);
+
+    /**Enumerate the hashes of the names of the files, for archives that can not list the names.
+     * @param hashes The hashes are appended to this list, as computed by
+     *               @ref NativeMpqArchive::fileNameHash, the hashes used by all MPQ archives
+     * @return true if the hashes of all the files were added. The default implementation returns
+     *         false without adding anything.
+     */
+    virtual bool listFileNameHashes(std::vector<uint64_t>& hashes);
 };
 }
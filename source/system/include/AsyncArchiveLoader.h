@@ -0,0 +1,100 @@
+/**
+ * @file AsyncArchiveLoader.h
+ * @author Lectem
+ */
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "Archive.h"
+#include "ThreadPool.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief Reads and decompresses files of an archive ahead of use, on I/O threads.
+ *
+ * Files are read entirely into @ref MemoryStream by a pool of I/O threads, so that the caller
+ * can decode a file while the next ones are being read and decompressed.
+ * - @ref openAsync starts reading a file immediately, and gives a future of the stream.
+ * - @ref prefetch queues files that will be needed later. They are kept until claimed by
+ *   @ref openAsync, and the number of prefetched files being read or waiting to be claimed is
+ *   bounded: the other ones wait for a previous prefetch to be claimed.
+ *
+ * If the archive is not thread-safe, the I/O threads take turns to read from it.
+ * The methods of this class can be called from any thread.
+ * @warning The archive must outlive the loader. The destructor waits for the reads in progress.
+ * @test{System,AsyncArchiveLoader}
+ */
+class AsyncArchiveLoader
+{
+public:
+    /**
+     * @param sourceArchive      The archive to read the files from
+     * @param nbThreads          Number of I/O threads
+     * @param maxPrefetchedFiles Maximum number of prefetched files being read or waiting to be
+     *                           claimed
+     */
+    explicit AsyncArchiveLoader(Archive& sourceArchive, size_t nbThreads = 2,
+                                size_t maxPrefetchedFiles = 16);
+    ~AsyncArchiveLoader();
+    AsyncArchiveLoader(const AsyncArchiveLoader&) = delete;
+    AsyncArchiveLoader& operator=(const AsyncArchiveLoader&) = delete;
+
+    /**Read a whole file in the background.
+     * If the file was prefetched, the prefetched read is used, and started now if it was waiting.
+     * @return A future of a MemoryStream of the file content, or of nullptr if it failed.
+     */
+    std::future<StreamPtr> openAsync(const Archive::path& filePath);
+
+    /**Start reading files that will be opened later with @ref openAsync.
+     * Files already prefetched and not claimed yet are ignored.
+     */
+    void prefetch(const std::vector<Archive::path>& filePaths);
+
+    /// Forget the prefetched files that were not claimed yet, and the ones waiting to be read
+    void cancelPrefetches();
+
+    /// Number of prefetched files not claimed yet, including the ones waiting to be read
+    size_t getPrefetchedNumber() const;
+
+private:
+    struct Request
+    {
+        Archive::path           filePath;
+        std::promise<StreamPtr> promise;
+        std::future<StreamPtr>  future;
+        bool                    usesBudget = false; ///< Prefetch counted in the budget
+        bool                    started    = false;
+        bool                    done       = false;
+        bool                    claimed    = false;
+    };
+    using RequestPtr = std::shared_ptr<Request>;
+
+    /// Must be called with the mutex locked
+    void start(const RequestPtr& request);
+    void execute(const RequestPtr& request);
+    /// Read the file, the content being a MemoryStream
+    StreamPtr readFile(const Archive::path& filePath);
+    /// Must be called with the mutex locked, starts waiting prefetches within the budget
+    void startWaitingPrefetches();
+
+    Archive&   archive;
+    std::mutex archiveMutex; ///< Serializes the reads if the archive is not thread-safe
+    bool       serializeReads;
+
+    mutable std::mutex                            mutex;
+    std::condition_variable                       idleCondition; ///< Notified when a read ends
+    std::unordered_map<Archive::path, RequestPtr> prefetched;    ///< Not claimed yet
+    std::deque<RequestPtr>                        waitingPrefetches;
+    size_t                                        maxPrefetched;
+    size_t                                        budgetUsed = 0;
+    size_t                                        running    = 0; ///< Number of reads started
+    ThreadPool                                    ioThreads;      ///< Destroyed first
+};
+} // namespace WorldStone
@@ -9,6 +9,7 @@
 #include <algorithm>
 #include <assert.h>
 #include <climits>
+#include <string.h> // memcpy
 #include <type_traits>
 #include "IOBase.h"
 namespace WorldStone
@@ -21,12 +22,17 @@ namespace WorldStone
  * This assumes that the data is ordered in a little endian fashion,
  * and signed values are encoded using 2's complement.
  *
+ * Reads are served from a 64-bit bit-buffer which is refilled with a single unaligned load when
+ * it does not hold enough bits. To avoid any check at the end of the stream, the refill may read
+ * up to @ref tailPaddingBytes bytes past the last byte of the stream.
+ *
  * @note This is basicly the bitstream format used by the @ref DCC format of Diablo 2
  * @note Does not inherit from @ref IStream to avoid confusion since size is in bits and not bytes.
  * Use @ref MemoryStream instead.
  * @warning As this class acts as a view, the buffer must outlive the usage of this class.
+ * @warning The buffer must be readable (but not necessarily initialized) for at least
+ *          @ref tailPaddingBytes bytes after @ref bufferSizeInBytes.
  * @todo Add some bounds checking and set io flags on error ?
- * @todo Implement a MemoryStream class
  * @test{System,RO_bitstream}
  */
 
@@ -37,8 +43,15 @@ class BitStreamView : public IOBase
     size_t      firstBitOffset     = 0;       ///< Position of the first bit in the first byte
     size_t      currentBitPosition = 0;       ///< Current absolute position in the buffer, in bits
     const byte* buffer             = nullptr; ///< The buffer we are reading from
+    uint64_t    bitBuffer          = 0;       ///< The next bits of the stream, LSB first
+    unsigned    bitsInBuffer       = 0;       ///< Number of valid bits in bitBuffer
 
 public:
+    /// Number of bytes that might be read past the end of the stream buffer.
+    static constexpr size_t tailPaddingBytes = sizeof(uint64_t);
+    /// Maximum number of bits that can be read in a single call.
+    static constexpr unsigned maxBitsPerRead = 64u - (CHAR_BIT - 1u);
+
     BitStreamView() = default;
     /// Creates a bitstream from raw memory
     BitStreamView(const void* inputBuffer, size_t sizeInBits, size_t firstBitOffsetInBuffer = 0)
@@ -68,6 +81,7 @@ public:
     {
         assert(newPosition >= 0_z && newPosition < size);
         currentBitPosition = newPosition + firstBitOffset;
+        bitsInBuffer       = 0;
     }
     /// Returns the current position in the buffer (ignoring the first bit position) in bits
     size_t bitPositionInBuffer() const { return currentBitPosition; }
@@ -75,13 +89,21 @@ public:
     void skip(size_t nbBits)
     {
         assert(currentBitPosition + nbBits < bufferSizeInBits());
-        currentBitPosition += nbBits;
+        if (nbBits < bitsInBuffer) {
+            consumeBits(unsigned(nbBits));
+        }
+        else
+        {
+            currentBitPosition += nbBits;
+            bitsInBuffer = 0;
+        }
     }
 
     void alignToByte()
     {
         // Remove the last 3 bytes to be a multiple of 8, but add 7 before so that we round up
         currentBitPosition = (currentBitPosition + 7_z) & (~0x7_z);
+        bitsInBuffer       = 0;
     }
 
     size_t bufferSizeInBytes() const { return (size + firstBitOffset + 7) / CHAR_BIT; }
@@ -95,59 +117,34 @@ public:
     /** Reads a single bit from the stream */
     bool readBool()
     {
-        const size_t currentBytesPos     = currentBitPosition / CHAR_BIT;
-        const size_t bitPosInCurrentByte = currentBitPosition % CHAR_BIT;
-        const int    mask                = (1 << bitPosInCurrentByte);
-        currentBitPosition++;
-        return (buffer[currentBytesPos] & mask) == mask;
+        if (bitsInBuffer == 0) refill();
+        const bool value = (bitBuffer & 1u) != 0;
+        consumeBits(1);
+        return value;
     }
     /** Reads a single bit from the stream (uint32_t version) */
     uint32_t readBit() { return uint32_t(readBool()); }
 
     /** Reads an unsigned value of variable bit size
      * @tparam RetType The type of the value to return, must be at least NbBits bits big.
-     * @param nbBits The number of bits to read from the stream
+     * @param nbBits The number of bits to read from the stream, at most @ref maxBitsPerRead
      */
     template<typename RetType = uint32_t>
     RetType readUnsigned(unsigned nbBits)
     {
         static_assert(std::is_unsigned<RetType>::value, "You must return an unsigned type !");
-        RetType value           = 0;
-        size_t  curBytesPos     = currentBitPosition / CHAR_BIT;
-        size_t  bitPosInCurByte = currentBitPosition % CHAR_BIT;
-        currentBitPosition += nbBits;
-        // The following variable is needed because we are reading a little endian input.
-        size_t curDestBitPosition = 0;
-        while (curDestBitPosition < nbBits)
-        {
-            // How many bits we can read in this byte ?
-            const size_t bitsToReadInCurByte =
-                std::min(CHAR_BIT - bitPosInCurByte, nbBits - curDestBitPosition);
-            const RetType mask = RetType((1U << bitsToReadInCurByte) - 1U);
-            // The bits we got from the current byte
-            const RetType inBits = (RetType(buffer[curBytesPos++]) >> bitPosInCurByte) & mask;
-            // Place them at the right position
-            value |= inBits << curDestBitPosition;
-            curDestBitPosition += bitsToReadInCurByte;
-            // Next time we start at the beginning of the byte, perhaps we could optimize by
-            // Treating the first byte as a special case ?
-            bitPosInCurByte = 0;
-        }
+        assert(nbBits <= maxBitsPerRead);
+        if (bitsInBuffer < nbBits) refill();
+        const uint64_t mask  = (uint64_t(1) << nbBits) - 1u;
+        const RetType  value = RetType(bitBuffer & mask);
+        consumeBits(nbBits);
         return value;
     }
 
     uint8_t readUnsigned8OrLess(const int nbBits)
     {
-        const size_t curBytesPos     = currentBitPosition / CHAR_BIT;
-        const int    bitPosInCurByte = currentBitPosition % CHAR_BIT;
-        currentBitPosition += size_t(nbBits);
-        // Note: Could get rid of the condition by having one extra byte at the end of the stream
-        const uint16_t shortFromBuffer =
-            buffer[curBytesPos] |
-            ((bitPosInCurByte + nbBits > 8) ? uint16_t(buffer[curBytesPos + 1] << CHAR_BIT) : 0);
-        const unsigned mask  = 0xFF >> (CHAR_BIT - nbBits);
-        const uint8_t  value = uint8_t((shortFromBuffer >> bitPosInCurByte) & mask);
-        return value;
+        assert(nbBits >= 0 && nbBits <= CHAR_BIT);
+        return readUnsigned<uint8_t>(unsigned(nbBits));
     }
 
     /** Return 0u, used for member function tables as replacement for BitStream::readUnsigned<0> */
@@ -174,5 +171,27 @@ public:
         currentBitPosition += NbBits;
         return 0;
     }
+
+private:
+    /** Loads the 64 bits starting at the byte of the current position.
+     * After a refill, at least @ref maxBitsPerRead bits are available.
+     * @note As for the rest of the decoders, this assumes a little endian host.
+     */
+    void refill()
+    {
+        const size_t   curBytesPos     = currentBitPosition / CHAR_BIT;
+        const unsigned bitPosInCurByte = unsigned(currentBitPosition % CHAR_BIT);
+        uint64_t       word;
+        memcpy(&word, buffer + curBytesPos, sizeof(word)); // Unaligned load, relies on the padding
+        bitBuffer    = word >> bitPosInCurByte;
+        bitsInBuffer = 64u - bitPosInCurByte;
+    }
+
+    void consumeBits(unsigned nbBits)
+    {
+        bitBuffer >>= nbBits;
+        bitsInBuffer -= nbBits;
+        currentBitPosition += nbBits;
+    }
 };
 }
@@ -0,0 +1,30 @@
+/**
+ * @file CpuFeatures.h
+ * @author Lectem
+ */
+#pragma once
+
+#include "Platform.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief Instruction sets supported by the processor running the application.
+ *
+ * Used to select at runtime the implementation of the functions that have SIMD versions.
+ * Those versions are compiled using @ref WS_TARGET so that the binary still runs on older
+ * processors.
+ * @test{System,CpuFeatures}
+ */
+struct CpuFeatures
+{
+    bool sse2  = false;
+    bool ssse3 = false;
+    bool sse41 = false;
+    bool avx2  = false; ///< Only set if the OS also saves the AVX registers
+
+    /// Returns the features of the current processor, detected on the first call
+    static const CpuFeatures& get();
+};
+} // namespace WorldStone
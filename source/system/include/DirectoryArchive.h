@@ -0,0 +1,46 @@
+/**
+ * @file DirectoryArchive.h
+ * @author Lectem
+ */
+
+#pragma once
+
+#include "Archive.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief An archive giving access to the files of a directory of the disk.
+ *
+ * Paths are relative to the root directory, and both '/' and '\' can be used as separators so
+ * that the same paths can be used for MPQ archives and loose files.
+ * Files are opened as @ref MmapFileStream, which support contiguous views.
+ * @test{System,VirtualFileSystem}
+ */
+class DirectoryArchive : public Archive
+{
+public:
+    DirectoryArchive(const path& rootDirectory);
+    ~DirectoryArchive() override;
+
+    bool exists(const path& filePath) override;
+    StreamPtr open(const path& filePath) override;
+    bool isThreadSafe() override { return true; }
+    /// Lists the regular files of the directory and its subdirectories, using '/' as separator
+    bool listFiles(std::vector<path>& files) override;
+
+    const path& getRootDirectory() const { return root; }
+
+private:
+    bool load() override;
+    bool is_loaded() override;
+    bool unload() override;
+
+    /// Path of the file on the disk
+    path getFullPath(const path& filePath) const;
+
+    path root;
+    bool loaded = false;
+};
+}
@@ -0,0 +1,142 @@
+/**
+ * @file MemoryStream.h
+ * @author Lectem
+ */
+
+#pragma once
+
+#include <string.h>
+#include <utility>
+#include "Stream.h"
+#include "Vector.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief A read-only stream over a block of memory it does not own.
+ *
+ * All the operations are inline and marked final, so that calls made through a SpanStream (or
+ * MemoryStream) reference or pointer are devirtualized by the compiler.
+ * @warning As this class acts as a view, the buffer must outlive the usage of this class.
+ * @test{System,RO_memorystreams}
+ */
+class SpanStream : public IStream
+{
+protected:
+    const uint8_t* data     = nullptr;
+    size_t         dataSize = 0;
+    size_t         position = 0;
+
+    /// Point the stream to a new buffer and rewind it, keeps the state flags untouched.
+    void setBuffer(const uint8_t* buffer, size_t size)
+    {
+        data     = buffer;
+        dataSize = size;
+        position = 0;
+    }
+
+public:
+    SpanStream() = default;
+    SpanStream(const void* buffer, size_t size)
+        : data(static_cast<const uint8_t*>(buffer)), dataSize(size)
+    {
+    }
+    ~SpanStream() override;
+
+    long size() final { return long(dataSize); }
+    long tell() final { return long(position); }
+
+    /// Like fseek, seeking past the end is valid, but reading from there will fail.
+    bool seek(long offset, seekdir origin) final
+    {
+        long base;
+        switch (origin)
+        {
+        case beg: base = 0; break;
+        case cur: base = long(position); break;
+        case end: base = long(dataSize); break;
+        default: setstate(failbit); return false;
+        }
+        if (offset < -base) {
+            setstate(failbit);
+            return false;
+        }
+        position = size_t(base + offset);
+        return good();
+    }
+
+    size_t read(void* buffer, size_t size) final
+    {
+        const size_t available = position < dataSize ? dataSize - position : 0;
+        const size_t readSize  = size < available ? size : available;
+        if (readSize) memcpy(buffer, data + position, readSize);
+        position += readSize;
+        if (readSize != size) setstate(eofbit | failbit);
+        return readSize;
+    }
+
+    int getc() final
+    {
+        if (position < dataSize) return data[position++];
+        setstate(eofbit | failbit);
+        return -1;
+    }
+
+    const uint8_t* tryGetContiguousView(size_t offset, size_t size) final
+    {
+        return (offset <= dataSize && size <= dataSize - offset) ? data + offset : nullptr;
+    }
+};
+
+/**
+ * @brief A read-only stream owning its content.
+ *
+ * This is typically used to pull a file from an @ref Archive once and decode it as many times as
+ * needed without touching the archive again.
+ * @test{System,RO_memorystreams}
+ */
+class MemoryStream final : public SpanStream
+{
+    Vector<uint8_t> buffer;
+
+public:
+    MemoryStream() = default;
+    /// Takes ownership of the content of a buffer
+    explicit MemoryStream(Vector<uint8_t>&& content) : buffer(std::move(content))
+    {
+        setBuffer(buffer.data(), buffer.size());
+    }
+    /// Copies the content of source, from its current position to its end. @see readFrom
+    explicit MemoryStream(IStream& source) { readFrom(source); }
+    ~MemoryStream() override;
+
+    MemoryStream(const MemoryStream&) = delete;
+    MemoryStream& operator=(const MemoryStream&) = delete;
+    MemoryStream(MemoryStream&& other) : SpanStream(), buffer(std::move(other.buffer))
+    {
+        setBuffer(buffer.data(), buffer.size());
+        position = other.position;
+        _state   = other._state;
+        other.setBuffer(nullptr, 0);
+    }
+    MemoryStream& operator=(MemoryStream&& other)
+    {
+        buffer = std::move(other.buffer);
+        setBuffer(buffer.data(), buffer.size());
+        position = other.position;
+        _state   = other._state;
+        other.setBuffer(nullptr, 0);
+        return *this;
+    }
+
+    /**Replace the content of the stream by the remaining content of source.
+     * The stream is rewound and its state is cleared on success.
+     * @return true on success. On failure, the stream is empty and its fail flag is set.
+     */
+    bool readFrom(IStream& source);
+
+    /// Give access to the content of the stream
+    const Vector<uint8_t>& getBuffer() const { return buffer; }
+};
+}
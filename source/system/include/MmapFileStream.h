@@ -0,0 +1,56 @@
+/**
+ * @file MmapFileStream.h
+ * @author Lectem
+ */
+
+#pragma once
+
+#include "Stream.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief A read-only file stream backed by a memory mapping of the whole file.
+ *
+ * Reads are plain memory copies and do not require any system call.
+ * As the whole file is mapped, @ref tryGetContiguousView is always available for ranges inside
+ * the file.
+ * @test{System,RO_filestreams}
+ */
+class MmapFileStream : public IStream
+{
+    const uint8_t* data     = nullptr; ///< Start of the mapping, nullptr for empty files
+    size_t         fileSize = 0;
+    size_t         position = 0;
+    bool           opened   = false;
+#ifdef _WIN32
+    void* mappingHandle = nullptr;
+#endif
+
+public:
+    MmapFileStream(const path& filename);
+    ~MmapFileStream() override;
+
+    bool open(const path& filename);
+    bool is_open() const { return opened; }
+    bool close();
+
+    long tell() override { return long(position); }
+    bool seek(long offset, seekdir origin) override;
+    long size() override { return long(fileSize); }
+
+    size_t read(void* buffer, size_t size) override;
+    int    getc() override
+    {
+        if (position < fileSize) return data[position++];
+        setstate(eofbit | failbit);
+        return -1;
+    }
+
+    const uint8_t* tryGetContiguousView(size_t offset, size_t size) override
+    {
+        return (offset <= fileSize && size <= fileSize - offset) ? data + offset : nullptr;
+    }
+};
+}
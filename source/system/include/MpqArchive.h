@@ -4,6 +4,7 @@
 
 #pragma once
 
+#include <mutex>
 #include <vector>
 #include "Archive.h"
 #include "Stream.h"
@@ -13,10 +14,18 @@ namespace WorldStone
 
 /**
  * @brief A wrapper to manage MPQ archives
+ *
+ * StormLib handles can not be used by multiple threads at once, so each opened file leases its own
+ * archive handle from a pool, which grows with the number of files opened at the same time.
+ * This makes @ref open, @ref exists and @ref findFiles safe to call from multiple threads.
+ * @warning The archive must outlive the streams it opened, and must not be moved while they exist.
+ * @test{System,MpqArchive}
  */
 class MpqArchive : public Archive
 {
     using HANDLE = void*; // Do not expose stormlib
+    friend class MpqFileStream;
+
 public:
     MpqArchive() { setstate(badbit); }
     MpqArchive(const char* MpqFileName);
@@ -27,7 +36,11 @@ public:
 
     bool exists(const path& filePath) override;
     StreamPtr open(const path& filePath) override;
+    bool isThreadSafe() override { return true; }
+    /// Lists the files known by the list files of the archive, @see addListFile
+    bool listFiles(std::vector<path>& files) override;
 
+    /// The handle used for the queries on the archive, files are opened using other handles
     HANDLE getInternalHandle() { return mpqHandle; }
 
     void addListFile(const path& listFilePAth);
@@ -38,8 +51,20 @@ private:
     bool is_loaded() override;
     bool unload() override;
 
+    /// Get an archive handle that is not used by any other file
+    HANDLE acquireFileHandle();
+    /// Give back a handle obtained with acquireFileHandle
+    void releaseFileHandle(HANDLE handle);
+
     path   mpqFileName;
     HANDLE mpqHandle = nullptr;
+    /// Protects mpqHandle, which is shared by all the queries
+    std::mutex queriesMutex;
+
+    /// Protects fileHandles and fileHandlesCount
+    std::mutex          fileHandlesMutex;
+    std::vector<HANDLE> fileHandles;          ///< The handles not used by any file
+    size_t              fileHandlesCount = 0; ///< Number of handles, including the leased ones
 };
 
 /**
@@ -49,7 +74,9 @@ class MpqFileStream : public IStream
 {
     using HANDLE = void*;
 
-    HANDLE file = nullptr;
+    HANDLE      file          = nullptr;
+    MpqArchive* sourceArchive = nullptr; ///< The archive the handle was leased from
+    HANDLE      archiveHandle = nullptr; ///< Archive handle used only by this file
 
 protected:
     MpqFileStream() = default; // Needed to make tests easier
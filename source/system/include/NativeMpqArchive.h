@@ -0,0 +1,177 @@
+/**
+ * @file NativeMpqArchive.h
+ * @author Lectem
+ */
+
+#pragma once
+
+#include <atomic>
+#include <memory>
+#include "Archive.h"
+#include "MmapFileStream.h"
+#include "SectorCache.h"
+#include "Stream.h"
+#include "Vector.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief A read-only MPQ archive reader that does not depend on StormLib.
+ *
+ * The archive is memory mapped, and its hash and block tables are decrypted once when loading.
+ * Since nothing is modified after that, @ref exists and @ref open do not need any lock and can be
+ * called from multiple threads at once. Each @ref NativeMpqFileStream keeps its own position and
+ * buffers, and reads the sectors directly from the mapping.
+ *
+ * Supported features:
+ * - Archives of format version 0 and 1 (with 16 bits table offsets extensions), possibly after a
+ *   user data header. Files must be in the first 4GB of the archive.
+ * - Encrypted files, including the ones using the adjusted key (MPQ_FILE_FIX_KEY).
+ * - PKWARE implode (MPQ_FILE_IMPLODE or compression mask 0x08) and zlib (mask 0x02, only when
+ *   built with WS_HAS_ZLIB) compressed files.
+ *
+ * Decompressed sectors are kept in a @ref SectorCache, the global one by default, so that
+ * reopening a file or seeking backwards in it does not decompress the same sectors again.
+ *
+ * Huffman, ADPCM, bzip2 and LZMA compressions are not supported, reading such sectors fails.
+ * In Diablo II they are only used by the sounds, use @ref MpqArchive for those.
+ * @warning The archive must outlive the streams it opened.
+ * @test{System,NativeMpqArchive}
+ */
+class NativeMpqArchive : public Archive
+{
+    friend class NativeMpqFileStream;
+
+public:
+    /// An entry of the hash table, used to find the block of a file from the hashes of its name
+    struct HashEntry
+    {
+        uint32_t hashA;      ///< Hash of the file name, using hash type 1
+        uint32_t hashB;      ///< Hash of the file name, using hash type 2
+        uint16_t locale;     ///< Language of the file, 0 being neutral
+        uint16_t platform;   ///< Unused, always 0
+        uint32_t blockIndex; ///< Index of the block of the file, or a special value (free entry)
+    };
+    /// An entry of the block table, describing where a file is and how it is stored
+    struct BlockEntry
+    {
+        uint32_t filePos;        ///< Offset of the file data, relative to the archive header
+        uint32_t compressedSize; ///< Size of the file data in the archive
+        uint32_t fileSize;       ///< Size of the file once decompressed
+        uint32_t flags;          ///< Combination of MPQ_FILE_* flags
+    };
+
+    NativeMpqArchive() { setstate(badbit); }
+    NativeMpqArchive(const path& MpqFileName);
+    ~NativeMpqArchive() override;
+
+    bool exists(const path& filePath) override;
+    StreamPtr open(const path& filePath) override;
+    bool isThreadSafe() override { return true; }
+    /// Lists the files named in the "(listfile)" of the archive
+    bool listFiles(std::vector<path>& files) override;
+    /// Lists the hashes of the hash table entries of the existing files
+    bool listFileNameHashes(std::vector<uint64_t>& hashes) override;
+
+    /**Find the block of a file, preferring the neutral locale.
+     * @return The block entry of the file, or nullptr if the file is not in the archive.
+     */
+    const BlockEntry* findBlock(const path& filePath) const;
+
+    /// Size of the sectors of the files, in bytes
+    uint32_t getSectorSize() const { return sectorSize; }
+
+    /**Change the cache used by the streams of the archive.
+     * This must be done before opening any file, so that unloading the archive removes all of its
+     * sectors from the cache they are in.
+     * @param cache The cache to use, or nullptr to disable caching. Must outlive the archive.
+     * @return false if files were already opened, in which case the cache is not changed
+     */
+    bool setSectorCache(SectorCache* cache);
+    SectorCache* getSectorCache() const { return sectorCache; }
+
+    /**Compute one of the hashes of a file name used by MPQ archives.
+     * The name is case insensitive, and '/' is the same as '\'.
+     * @param fileName The name to hash
+     * @param hashType 0 for the hash table offset, 1 and 2 for the name hashes, 3 for the file key
+     */
+    static uint32_t hashString(const char* fileName, uint32_t hashType);
+    /// The name hashes of the hash table (hash types 1 and 2), combined. @see listFileNameHashes
+    static uint64_t fileNameHash(const char* fileName);
+
+private:
+    bool load() override;
+    bool is_loaded() override;
+    bool unload() override;
+
+    path                            mpqFileName;
+    std::unique_ptr<MmapFileStream> mappedFile;
+    const uint8_t*                  archiveData = nullptr; ///< Points to the MPQ header
+    size_t                          archiveSize = 0;       ///< Bytes available after the header
+    uint32_t                        sectorSize  = 0;
+    uint64_t                        archiveId   = 0; ///< Identifies the archive in the cache
+    SectorCache*                    sectorCache = &SectorCache::global();
+    std::atomic<bool>               filesOpened{false}; ///< The cache can not be changed anymore
+    Vector<HashEntry>               hashTable;
+    Vector<BlockEntry>              blockTable;
+};
+
+/**
+ * @brief A file from a NativeMpqArchive
+ *
+ * Sectors are decompressed straight into the buffer given to @ref read when it covers them
+ * entirely, otherwise the last sector read is kept to serve the following small reads.
+ * Sectors found in the @ref SectorCache of the archive are copied from there instead.
+ * Files that are neither compressed nor encrypted are read directly from the mapping of the
+ * archive, and support @ref tryGetContiguousView.
+ * @test{System,RO_filestreams}
+ */
+class NativeMpqFileStream : public IStream
+{
+public:
+    NativeMpqFileStream(NativeMpqArchive& archive, const path& filename);
+    ~NativeMpqFileStream() override;
+
+    bool is_open() const { return fileData != nullptr; }
+
+    size_t read(void* buffer, size_t size) override;
+
+    long tell() override { return long(position); }
+    long size() override { return long(fileSize); }
+    bool seek(long offset, seekdir origin) override;
+
+    const uint8_t* tryGetContiguousView(size_t offset, size_t size) override;
+
+private:
+    bool open(NativeMpqArchive& archive, const path& filename);
+    /// Size of the sector once decompressed
+    size_t sectorLength(size_t sector) const;
+    /// Decrypt and decompress a sector into destination, which must hold sectorLength(sector)
+    bool decodeSector(size_t sector, uint8_t* destination);
+    /// Read a whole sector into destination, from the cache if possible
+    bool readSector(size_t sector, uint8_t* destination);
+    /// Get a sector from the cache, or decode it and add it to the cache
+    SectorCache::SectorPtr loadSector(size_t sector);
+    SectorCache::Key cacheKey(size_t sector) const
+    {
+        return {archiveId, blockIndex, uint32_t(sector)};
+    }
+
+    const uint8_t*         fileData       = nullptr; ///< Data of the file in the archive mapping
+    size_t                 dataSize       = 0;       ///< Number of bytes of the file in the archive
+    size_t                 fileSize       = 0;
+    uint32_t               flags          = 0;
+    uint32_t               key            = 0;     ///< Encryption key of the first sector
+    size_t                 unitSize       = 0;     ///< Size of the sectors, or of the single unit
+    bool                   isRaw          = false; ///< Neither compressed nor encrypted
+    size_t                 position       = 0;
+    SectorCache*           cache          = nullptr;
+    uint64_t               archiveId      = 0;
+    uint32_t               blockIndex     = 0;
+    size_t                 bufferedSector = size_t(-1); ///< Index of the sector in sectorBuffer
+    SectorCache::SectorPtr sectorBuffer;  ///< The content of the last partially read sector
+    Vector<uint32_t>       sectorOffsets; ///< Offsets of the sectors in fileData, and of their end
+    Vector<uint8_t>        scratch;       ///< To decrypt the sectors, the mapping is read-only
+};
+}
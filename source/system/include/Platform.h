@@ -36,6 +36,21 @@
 #define WS_32BITS
 #endif
 
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+/// Defined if compiling for x86 or x86_64 processors
+#define WS_X86
+#endif
+
+#if defined(WS_GCC_FAMILY) || defined(WS_CLANG)
+/**Lets a function use the instructions of a given target (eg: "avx2") while the rest of the
+ * translation unit does not. Calls to such functions must be guarded by @ref CpuFeatures.
+ * MSVC does not need it as its intrinsics are always available.
+ */
+#define WS_TARGET(targetName) __attribute__((target(targetName)))
+#else
+#define WS_TARGET(targetName)
+#endif
+
 /**
  * Types support
  */
@@ -0,0 +1,106 @@
+/**
+ * @file SectorCache.h
+ * @author Lectem
+ */
+#pragma once
+
+#include <list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include "Vector.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief A size-bounded cache of decompressed archive sectors, with LRU eviction.
+ *
+ * Reopening a file or seeking backwards in it would otherwise decompress the same sectors again.
+ * Sectors are shared through shared_ptr, so that a stream can keep using a sector that was
+ * evicted in the meantime. All the methods are thread-safe, and only hold the lock for the time of
+ * the lookup: decompression is done by the callers, without the lock.
+ * @test{System,SectorCache}
+ */
+class SectorCache
+{
+public:
+    /// Identifies a sector of a file of an archive
+    struct Key
+    {
+        uint64_t archiveId;   ///< Unique for each loaded archive, never reused
+        uint32_t blockIndex;  ///< Index of the file in the block table
+        uint32_t sectorIndex; ///< Index of the sector in the file
+
+        bool operator==(const Key& rhs) const
+        {
+            return archiveId == rhs.archiveId && blockIndex == rhs.blockIndex &&
+                   sectorIndex == rhs.sectorIndex;
+        }
+    };
+    using SectorPtr = std::shared_ptr<const Vector<uint8_t>>;
+
+    struct Stats
+    {
+        uint64_t hits      = 0;
+        uint64_t misses    = 0;
+        uint64_t evictions = 0;
+        size_t   entries   = 0; ///< Number of sectors currently in the cache
+        size_t   bytes     = 0; ///< Total size of the sectors currently in the cache
+    };
+
+    /// @param capacityInBytes Maximum total size of the sectors kept, 0 disables the cache
+    explicit SectorCache(size_t capacityInBytes = defaultCapacity);
+    SectorCache(const SectorCache&) = delete;
+    SectorCache& operator=(const SectorCache&) = delete;
+
+    /**Look for a sector, and mark it as the most recently used on success.
+     * @return The content of the sector, or nullptr if not in the cache.
+     */
+    SectorPtr find(const Key& key);
+    /// Add a sector, evicting the least recently used ones if needed
+    void insert(const Key& key, SectorPtr sector);
+    /// Remove all the sectors of an archive, eg: when unloading it
+    void eraseArchive(uint64_t archiveId);
+    void clear();
+
+    /// Change the capacity, evicting sectors if needed
+    void setCapacity(size_t capacityInBytes);
+    size_t getCapacity() const;
+
+    Stats getStats() const;
+    /// Reset the hits, misses and evictions counters
+    void resetStats();
+
+    /// The cache shared by all the archives of the process, unless told otherwise
+    static SectorCache& global();
+
+    static const size_t defaultCapacity = 64 * 1024 * 1024;
+
+private:
+    struct KeyHash
+    {
+        size_t operator()(const Key& key) const
+        {
+            const uint64_t sectorKey = (uint64_t(key.blockIndex) << 32) | key.sectorIndex;
+            return std::hash<uint64_t>()(sectorKey ^ (key.archiveId * 0x9E3779B97F4A7C15ull));
+        }
+    };
+    struct Entry
+    {
+        Key       key;
+        SectorPtr sector;
+    };
+    using LruList = std::list<Entry>;
+
+    /// Evict the least recently used entries until the size fits the capacity
+    void shrinkTo(size_t maxBytes);
+    void erase(LruList::iterator entry);
+
+    mutable std::mutex                                  mutex;
+    size_t                                              capacity;
+    LruList                                             lru; ///< Most recently used first
+    std::unordered_map<Key, LruList::iterator, KeyHash> entries;
+    Stats                                               stats;
+};
+} // namespace WorldStone
@@ -5,6 +5,7 @@
  */
 #pragma once
 
+#include <stdint.h>
 #include <memory>
 #include "IOBase.h"
 
@@ -73,6 +74,16 @@ public:
      * @see seekdir values : beg cur end
      */
     virtual bool seek(long offset, seekdir origin) = 0;
+    /**
+     * Get direct access to the data of the stream, if the implementation supports it.
+     * @param offset Position of the first byte of the view, relative to the beginning of the stream
+     * @param size   Number of bytes that must be readable from the returned pointer
+     * @return A pointer to the data that stays valid as long as the stream is opened,
+     *         or nullptr if not supported or if the range is not inside the stream.
+     * @note This does not change the position of the stream, nor its state.
+     *       Callers must fall back to @ref read when nullptr is returned.
+     */
+    virtual const uint8_t* tryGetContiguousView(size_t offset, size_t size);
 
     virtual ~IStream();
 };
@@ -0,0 +1,80 @@
+/**
+ * @file ThreadPool.h
+ * @author Lectem
+ */
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include "Vector.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief A fixed-size pool of worker threads consuming a FIFO queue of tasks.
+ *
+ * Tasks are run in the order they were enqueued, but may complete in any order.
+ * @note parallelFor can safely be called from a task of the same pool, as the calling thread
+ *       takes part in the work instead of only waiting for the workers.
+ * @test{System,ThreadPool}
+ */
+class ThreadPool
+{
+public:
+    /// Creates a pool of nbThreads workers, defaults to the number of hardware threads.
+    explicit ThreadPool(size_t nbThreads = std::thread::hardware_concurrency());
+    /// Waits for the queued tasks to complete and joins the workers
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    /// Returns the number of worker threads
+    size_t size() const { return workers.size(); }
+
+    /**Queue a task to be run by one of the workers.
+     * @return A future that will hold the result of the task, or the exception it threw.
+     */
+    template<class Function>
+    std::future<typename std::result_of<Function()>::type> enqueue(Function&& func)
+    {
+        using ResultType = typename std::result_of<Function()>::type;
+        auto task =
+            std::make_shared<std::packaged_task<ResultType()>>(std::forward<Function>(func));
+        std::future<ResultType> result = task->get_future();
+        push([task]() { (*task)(); });
+        return result;
+    }
+
+    /**Calls func(index) for every index in [0, count) and waits for all the calls to return.
+     * The calls are distributed between the workers and the calling thread.
+     * If any of the calls throws, the first exception is rethrown once all calls returned.
+     */
+    template<class Function>
+    void parallelFor(size_t count, Function&& func)
+    {
+        if (count == 0) return;
+        std::function<void(size_t)> callable = std::forward<Function>(func);
+        runParallelFor(count, callable);
+    }
+
+private:
+    void push(std::function<void()>&& task);
+    void workerLoop();
+    void runParallelFor(size_t count, const std::function<void(size_t)>& func);
+
+    Vector<std::thread>               workers;
+    std::deque<std::function<void()>> tasks;
+    std::mutex                        tasksMutex;
+    std::condition_variable           tasksCondition;
+    bool                              stopping = false;
+};
+} // namespace WorldStone
@@ -0,0 +1,110 @@
+/**
+ * @file VirtualFileSystem.h
+ * @author Lectem
+ */
+
+#pragma once
+
+#include <memory>
+#include <unordered_map>
+#include "Archive.h"
+#include "Vector.h"
+
+namespace WorldStone
+{
+
+/**
+ * @brief An archive made of other archives (MPQs, directories...) stacked by priority.
+ *
+ * When the same file is in multiple sources, the one with the highest priority is used, or the
+ * last one mounted in case of equal priorities. For Diablo II, this means mounting d2data.mpq,
+ * then d2exp.mpq and patch_d2.mpq with increasing priorities, and a @ref DirectoryArchive of
+ * loose files on top of them.
+ *
+ * Mounting a source lists its files once, and adds them to a single hashed index of normalized
+ * paths (case insensitive, '/' and '\' are the same). @ref exists and @ref open are then a
+ * lookup in this index, instead of probing every source in turn.
+ * MPQ archives can not list all their names, but a @ref NativeMpqArchive lists the hashes of the
+ * names of all its files, which go to a second index. A lookup is then two hash table lookups.
+ * The sources that can list neither, such as @ref MpqArchive, are probed in order of priority,
+ * but only those with a higher priority than the source found in the indices, if any.
+ *
+ * @note Mounting is not thread-safe, but once done @ref exists and @ref open can be called from
+ *       multiple threads if all the sources are thread-safe.
+ * @test{System,VirtualFileSystem}
+ */
+class VirtualFileSystem : public Archive
+{
+public:
+    VirtualFileSystem() = default;
+    ~VirtualFileSystem() override;
+
+    /**Add a source of files.
+     * @param source    The archive to mount, which is owned by the filesystem from now on
+     * @param priority  Sources with a higher priority hide the files of the lower ones
+     * @param fileNames Additional names of files of the source, for example from an external
+     *                  list file for MPQ archives. Names that do not exist in the source are
+     *                  ignored.
+     * @return false if the source is invalid, in which case it is not mounted
+     */
+    bool mount(std::unique_ptr<Archive> source, int priority,
+               const std::vector<path>& fileNames = {});
+
+    /// Build the index again, eg: if the list files of the sources changed
+    void rebuildIndex();
+
+    bool exists(const path& filePath) override;
+    StreamPtr open(const path& filePath) override;
+    /// True if all the sources are thread-safe
+    bool isThreadSafe() override;
+    /**Lists the files of the index, with their names as given by their sources.
+     * @return false if some files are only known by the hashes of their names, or not at all
+     */
+    bool listFiles(std::vector<path>& files) override;
+
+    /// @return The source in which filePath would be opened, or nullptr if not found
+    Archive* findSource(const path& filePath);
+
+    size_t   getSourcesNumber() const { return sources.size(); }
+    Archive& getSource(size_t sourceIndex) { return *sources[sourceIndex].archive; }
+    /// Number of files in the index
+    size_t getIndexSize() const { return index.size(); }
+
+    /// Lower case and '\' separators, the key used by the index
+    static path normalizePath(const path& filePath);
+
+private:
+    bool load() override { return good(); }
+    bool is_loaded() override { return true; }
+    bool unload() override { return good(); }
+
+    struct Source
+    {
+        std::unique_ptr<Archive> archive;
+        int                      priority;
+        bool                     completeList;   ///< If false, must be probed on lookups
+        std::vector<path>        extraFileNames; ///< Given when mounting
+    };
+    struct IndexEntry
+    {
+        size_t sourceIndex;
+        path   sourcePath; ///< The name of the file for its source
+    };
+
+    /// Add the files of a source to the index
+    void indexSource(size_t sourceIndex);
+    /// True if the source a hides the source b
+    bool hides(size_t a, size_t b) const;
+    /**Finds the source of a file, and the name of the file for this source.
+     * @return false if the file was not found
+     */
+    bool locate(const path& filePath, size_t& sourceIndex, const path*& sourcePath);
+
+    Vector<Source> sources;
+    /// Indices of the sources with incomplete lists, highest priority first
+    Vector<size_t>                       probedSources;
+    std::unordered_map<path, IndexEntry> index; ///< Normalized path to the source of the file
+    /// Hash of the name to the source of the file, for the sources that only list hashes
+    std::unordered_map<uint64_t, size_t> hashIndex;
+};
+}
@@ -0,0 +1,145 @@
+/**
+ * @file AsyncArchiveLoader.cpp
+ * @author Lectem
+ */
+
+#include "AsyncArchiveLoader.h"
+#include <algorithm>
+#include "MemoryStream.h"
+
+namespace WorldStone
+{
+
+AsyncArchiveLoader::AsyncArchiveLoader(Archive& sourceArchive, size_t nbThreads,
+                                       size_t maxPrefetchedFiles)
+    : archive(sourceArchive),
+      serializeReads(!sourceArchive.isThreadSafe()),
+      maxPrefetched(std::max<size_t>(maxPrefetchedFiles, 1)),
+      ioThreads(std::max<size_t>(nbThreads, 1))
+{
+}
+
+AsyncArchiveLoader::~AsyncArchiveLoader()
+{
+    cancelPrefetches();
+    std::unique_lock<std::mutex> lock(mutex);
+    idleCondition.wait(lock, [this] { return running == 0; });
+}
+
+std::future<StreamPtr> AsyncArchiveLoader::openAsync(const Archive::path& filePath)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto found = prefetched.find(filePath);
+    if (found != prefetched.end()) {
+        RequestPtr request = std::move(found->second);
+        prefetched.erase(found);
+        request->claimed = true;
+        if (!request->started) {
+            // The file is needed now, do not make it wait for the budget
+            waitingPrefetches.erase(
+                std::find(waitingPrefetches.begin(), waitingPrefetches.end(), request));
+            request->usesBudget = false;
+            start(request);
+        }
+        else if (request->done) {
+            budgetUsed--;
+            startWaitingPrefetches();
+        }
+        return std::move(request->future);
+    }
+
+    RequestPtr request = std::make_shared<Request>();
+    request->filePath  = filePath;
+    request->future    = request->promise.get_future();
+    request->claimed   = true;
+    start(request);
+    return std::move(request->future);
+}
+
+void AsyncArchiveLoader::prefetch(const std::vector<Archive::path>& filePaths)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (const Archive::path& filePath : filePaths)
+    {
+        if (prefetched.count(filePath)) continue;
+        RequestPtr request  = std::make_shared<Request>();
+        request->filePath   = filePath;
+        request->future     = request->promise.get_future();
+        request->usesBudget = true;
+        prefetched.emplace(filePath, request);
+        waitingPrefetches.push_back(std::move(request));
+    }
+    startWaitingPrefetches();
+}
+
+void AsyncArchiveLoader::cancelPrefetches()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    waitingPrefetches.clear();
+    for (auto& entry : prefetched)
+    {
+        Request& request = *entry.second;
+        // The reads in progress release their budget when done
+        request.claimed = true;
+        if (request.started && request.done) budgetUsed--;
+    }
+    prefetched.clear();
+}
+
+size_t AsyncArchiveLoader::getPrefetchedNumber() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return prefetched.size();
+}
+
+void AsyncArchiveLoader::start(const RequestPtr& request)
+{
+    request->started = true;
+    running++;
+    if (request->usesBudget) budgetUsed++;
+    ioThreads.enqueue([this, request]() { execute(request); });
+}
+
+void AsyncArchiveLoader::startWaitingPrefetches()
+{
+    while (budgetUsed < maxPrefetched && !waitingPrefetches.empty())
+    {
+        RequestPtr request = std::move(waitingPrefetches.front());
+        waitingPrefetches.pop_front();
+        start(request);
+    }
+}
+
+void AsyncArchiveLoader::execute(const RequestPtr& request)
+{
+    try
+    {
+        request->promise.set_value(readFile(request->filePath));
+    }
+    catch (...)
+    {
+        request->promise.set_exception(std::current_exception());
+    }
+
+    std::lock_guard<std::mutex> lock(mutex);
+    request->done = true;
+    // Prefetched files keep their budget until claimed, as they still use memory
+    if (request->usesBudget && request->claimed) {
+        budgetUsed--;
+        startWaitingPrefetches();
+    }
+    running--;
+    idleCondition.notify_all();
+}
+
+StreamPtr AsyncArchiveLoader::readFile(const Archive::path& filePath)
+{
+    std::unique_lock<std::mutex> archiveLock(archiveMutex, std::defer_lock);
+    if (serializeReads) archiveLock.lock();
+    StreamPtr source = archive.open(filePath);
+    if (!source) return nullptr;
+    // Reading the whole file here is what moves the decompression to the I/O threads
+    auto content = std::make_unique<MemoryStream>();
+    return content->readFrom(*source) ? std::move(content) : nullptr;
+}
+}
@@ -7,4 +7,6 @@
 
 namespace WorldStone
 {
+constexpr size_t   BitStreamView::tailPaddingBytes;
+constexpr unsigned BitStreamView::maxBitsPerRead;
 }
@@ -0,0 +1,47 @@
+/**
+ * @file CpuFeatures.cpp
+ * @author Lectem
+ */
+
+#include "CpuFeatures.h"
+
+namespace WorldStone
+{
+
+namespace
+{
+CpuFeatures detectCpuFeatures()
+{
+    CpuFeatures features;
+#if defined(WS_X86) && defined(WS_GCC_FAMILY)
+    __builtin_cpu_init();
+    features.sse2  = __builtin_cpu_supports("sse2");
+    features.ssse3 = __builtin_cpu_supports("ssse3");
+    features.sse41 = __builtin_cpu_supports("sse4.1");
+    // libgcc already checks that the OS saves the AVX registers
+    features.avx2 = __builtin_cpu_supports("avx2");
+#elif defined(WS_X86) && defined(WS_MSC)
+    int info[4];
+    __cpuid(info, 0);
+    const int maxLeaf = info[0];
+    __cpuid(info, 1);
+    features.sse2         = (info[3] & (1 << 26)) != 0;
+    features.ssse3        = (info[2] & (1 << 9)) != 0;
+    features.sse41        = (info[2] & (1 << 19)) != 0;
+    const bool hasAvx     = (info[2] & (1 << 28)) != 0;
+    const bool osSavesAvx = (info[2] & (1 << 27)) != 0 && (_xgetbv(0) & 0x6) == 0x6;
+    if (maxLeaf >= 7 && hasAvx && osSavesAvx) {
+        __cpuidex(info, 7, 0);
+        features.avx2 = (info[1] & (1 << 5)) != 0;
+    }
+#endif
+    return features;
+}
+} // anonymous namespace
+
+const CpuFeatures& CpuFeatures::get()
+{
+    static const CpuFeatures features = detectCpuFeatures();
+    return features;
+}
+} // namespace WorldStone
@@ -0,0 +1,149 @@
+/**
+ * @file DirectoryArchive.cpp
+ * @author Lectem
+ */
+
+#include "DirectoryArchive.h"
+#include <algorithm>
+#include "MmapFileStream.h"
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <dirent.h>
+#include <sys/stat.h>
+#endif
+
+namespace WorldStone
+{
+
+namespace
+{
+#ifdef _WIN32
+bool isDirectory(const std::string& fullPath)
+{
+    const DWORD attributes = GetFileAttributesA(fullPath.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && (attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+bool isRegularFile(const std::string& fullPath)
+{
+    const DWORD attributes = GetFileAttributesA(fullPath.c_str());
+    return attributes != INVALID_FILE_ATTRIBUTES && !(attributes & FILE_ATTRIBUTE_DIRECTORY);
+}
+
+/// Appends the files of the directory fullPath to files, prefixed by relativePath
+void listDirectory(const std::string& fullPath, const std::string& relativePath,
+                   std::vector<std::string>& files)
+{
+    WIN32_FIND_DATAA findData;
+    HANDLE           findHandle = FindFirstFileA((fullPath + "/*").c_str(), &findData);
+    if (findHandle == INVALID_HANDLE_VALUE) return;
+    do
+    {
+        const std::string name = findData.cFileName;
+        if (name == "." || name == "..") continue;
+        // Do not follow junctions and links to directories, they could lead to a loop
+        const DWORD attributes = findData.dwFileAttributes;
+        if ((attributes & FILE_ATTRIBUTE_DIRECTORY) && (attributes & FILE_ATTRIBUTE_REPARSE_POINT))
+            continue;
+        if (attributes & FILE_ATTRIBUTE_DIRECTORY)
+            listDirectory(fullPath + "/" + name, relativePath + name + "/", files);
+        else
+            files.push_back(relativePath + name);
+    } while (FindNextFileA(findHandle, &findData));
+    FindClose(findHandle);
+}
+#else
+bool isDirectory(const std::string& fullPath)
+{
+    struct stat fileStat;
+    return stat(fullPath.c_str(), &fileStat) == 0 && S_ISDIR(fileStat.st_mode);
+}
+
+bool isRegularFile(const std::string& fullPath)
+{
+    struct stat fileStat;
+    return stat(fullPath.c_str(), &fileStat) == 0 && S_ISREG(fileStat.st_mode);
+}
+
+/// Appends the files of the directory fullPath to files, prefixed by relativePath
+void listDirectory(const std::string& fullPath, const std::string& relativePath,
+                   std::vector<std::string>& files)
+{
+    DIR* directory = opendir(fullPath.c_str());
+    if (!directory) return;
+    while (const dirent* entry = readdir(directory))
+    {
+        const std::string name = entry->d_name;
+        if (name == "." || name == "..") continue;
+        const std::string entryPath = fullPath + "/" + name;
+        // d_type is not supported by all filesystems, lstat tells us in any case.
+        // Links to directories are not followed, as they could lead to a loop.
+        struct stat entryStat;
+        if (lstat(entryPath.c_str(), &entryStat) != 0) continue;
+        if (S_ISDIR(entryStat.st_mode))
+            listDirectory(entryPath, relativePath + name + "/", files);
+        else if (isRegularFile(entryPath)) // Links to files are followed
+            files.push_back(relativePath + name);
+    }
+    closedir(directory);
+}
+#endif
+} // anonymous namespace
+
+DirectoryArchive::DirectoryArchive(const path& rootDirectory) : root(rootDirectory) { load(); }
+
+DirectoryArchive::~DirectoryArchive() { unload(); }
+
+bool DirectoryArchive::load()
+{
+    // Remove the trailing separators, so that we can simply append the relative paths
+    while (root.size() > 1 && (root.back() == '/' || root.back() == '\\'))
+        root.pop_back();
+    loaded = isDirectory(root);
+    if (!loaded) setstate(failbit);
+    return good();
+}
+
+bool DirectoryArchive::is_loaded() { return loaded; }
+
+bool DirectoryArchive::unload()
+{
+    if (!loaded) setstate(failbit);
+    loaded = false;
+    return good();
+}
+
+DirectoryArchive::path DirectoryArchive::getFullPath(const path& filePath) const
+{
+    path fullPath = root + "/" + filePath;
+    std::replace(fullPath.begin() + ptrdiff_t(root.size()), fullPath.end(), '\\', '/');
+    return fullPath;
+}
+
+bool DirectoryArchive::exists(const path& filePath)
+{
+    return loaded && isRegularFile(getFullPath(filePath));
+}
+
+StreamPtr DirectoryArchive::open(const path& filePath)
+{
+    if (!loaded) return nullptr;
+    StreamPtr stream = std::make_unique<MmapFileStream>(getFullPath(filePath));
+    return stream->good() ? std::move(stream) : nullptr;
+}
+
+bool DirectoryArchive::listFiles(std::vector<path>& files)
+{
+    if (!loaded) return false;
+    listDirectory(root, "", files);
+    return true;
+}
+}
@@ -0,0 +1,36 @@
+/**
+ * @file MemoryStream.cpp
+ * @author Lectem
+ */
+
+#include "MemoryStream.h"
+
+namespace WorldStone
+{
+
+// Out of line to avoid weak vtables
+SpanStream::~SpanStream() {}
+MemoryStream::~MemoryStream() {}
+
+bool MemoryStream::readFrom(IStream& source)
+{
+    buffer.clear();
+    setBuffer(nullptr, 0);
+    _state = goodbit;
+
+    const long startPosition = source.tell();
+    const long endPosition   = source.size();
+    if (startPosition < 0 || endPosition < startPosition) {
+        setstate(failbit);
+        return false;
+    }
+    buffer.resize(size_t(endPosition - startPosition));
+    if (!buffer.empty() && source.read(buffer.data(), buffer.size()) != buffer.size()) {
+        buffer.clear();
+        setstate(failbit);
+        return false;
+    }
+    setBuffer(buffer.data(), buffer.size());
+    return true;
+}
+}
@@ -0,0 +1,159 @@
+/**
+ * @file MmapFileStream.cpp
+ * @author Lectem
+ */
+
+#include "MmapFileStream.h"
+#include <assert.h>
+#include <string.h>
+
+#ifdef _WIN32
+#ifndef WIN32_LEAN_AND_MEAN
+#define WIN32_LEAN_AND_MEAN
+#endif
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace WorldStone
+{
+
+MmapFileStream::MmapFileStream(const path& filename) { open(filename); }
+
+MmapFileStream::~MmapFileStream()
+{
+    if (opened) close();
+}
+
+#ifdef _WIN32
+bool MmapFileStream::open(const path& filename)
+{
+    assert(!opened);
+    HANDLE file = CreateFileA(filename.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+                              OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        setstate(failbit);
+        return false;
+    }
+    LARGE_INTEGER sizeInBytes;
+    if (!GetFileSizeEx(file, &sizeInBytes)) {
+        CloseHandle(file);
+        setstate(failbit);
+        return false;
+    }
+    fileSize = size_t(sizeInBytes.QuadPart);
+    if (fileSize) // Can not map empty files
+    {
+        mappingHandle = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mappingHandle) {
+            data = static_cast<const uint8_t*>(
+                MapViewOfFile(mappingHandle, FILE_MAP_READ, 0, 0, fileSize));
+        }
+        if (!data) {
+            if (mappingHandle) CloseHandle(mappingHandle);
+            mappingHandle = nullptr;
+            CloseHandle(file);
+            setstate(failbit);
+            return false;
+        }
+    }
+    // The mapping keeps a reference to the file
+    CloseHandle(file);
+    opened = true;
+    return good();
+}
+
+bool MmapFileStream::close()
+{
+    if (!opened) setstate(failbit);
+    if (data) UnmapViewOfFile(data);
+    if (mappingHandle) CloseHandle(mappingHandle);
+    data          = nullptr;
+    mappingHandle = nullptr;
+    fileSize      = 0;
+    position      = 0;
+    opened        = false;
+    return good();
+}
+#else
+bool MmapFileStream::open(const path& filename)
+{
+    assert(!opened);
+    const int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd == -1) {
+        setstate(failbit);
+        return false;
+    }
+    struct stat fileStat;
+    if (fstat(fd, &fileStat) != 0) {
+        ::close(fd);
+        setstate(failbit);
+        return false;
+    }
+    fileSize = size_t(fileStat.st_size);
+    if (fileSize) // Can not map empty files
+    {
+        void* mapping = mmap(nullptr, fileSize, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapping == MAP_FAILED) {
+            ::close(fd);
+            setstate(failbit);
+            return false;
+        }
+        data = static_cast<const uint8_t*>(mapping);
+    }
+    // The mapping keeps a reference to the file
+    ::close(fd);
+    opened = true;
+    return good();
+}
+
+bool MmapFileStream::close()
+{
+    if (!opened || (data && munmap(const_cast<uint8_t*>(data), fileSize) != 0))
+        setstate(failbit);
+    data     = nullptr;
+    fileSize = 0;
+    position = 0;
+    opened   = false;
+    return good();
+}
+#endif
+
+size_t MmapFileStream::read(void* buffer, size_t size)
+{
+    assert(is_open());
+    const size_t available = position < fileSize ? fileSize - position : 0;
+    const size_t readSize  = size < available ? size : available;
+    if (readSize) memcpy(buffer, data + position, readSize);
+    position += readSize;
+    if (readSize != size) setstate(eofbit | failbit);
+    return readSize;
+}
+
+bool MmapFileStream::seek(long offset, IStream::seekdir origin)
+{
+    assert(is_open());
+    long base = 0;
+    switch (origin)
+    {
+    case beg: base = 0; break;
+    case cur: base = long(position); break;
+    case end: base = long(fileSize); break;
+    default: setstate(failbit); return false;
+    }
+    // Like fseek, seeking past the end is valid, but reading from there will fail.
+    if (offset < -base) {
+        setstate(failbit);
+        return false;
+    }
+    position = size_t(base + offset);
+    return good();
+}
+}
@@ -4,6 +4,7 @@
 
 #include "MpqArchive.h"
 #include <StormLib.h>
+#include <assert.h>
 #include <fmt/format.h>
 #include <type_traits>
 
@@ -17,6 +18,8 @@ MpqArchive& MpqArchive::operator=(MpqArchive&& toMove)
     std::swap(mpqHandle, toMove.mpqHandle);
     std::swap(mpqFileName, toMove.mpqFileName);
     std::swap(_state, toMove._state);
+    std::swap(fileHandles, toMove.fileHandles);
+    std::swap(fileHandlesCount, toMove.fileHandlesCount);
     return *this;
 }
 MpqArchive::MpqArchive(const char* MpqFileName) : mpqFileName(MpqFileName)
@@ -33,13 +36,15 @@ MpqArchive::~MpqArchive() { unload(); }
 void MpqArchive::addListFile(const path& listFilePAth)
 {
     if (!mpqHandle) return;
+    std::lock_guard<std::mutex> lock(queriesMutex);
     if (SFileAddListFile(mpqHandle, listFilePAth.c_str()) != ERROR_SUCCESS) setstate(failbit);
 }
 
 std::vector<MpqArchive::path> MpqArchive::findFiles(const path& searchMask)
 {
     if (!mpqHandle) return {};
-    std::vector<path> list;
+    std::lock_guard<std::mutex> lock(queriesMutex);
+    std::vector<path>           list;
     SFILE_FIND_DATA   findFileData;
     HANDLE findHandle = SFileFindFirstFile(mpqHandle, searchMask.c_str(), &findFileData, nullptr);
     if (!findHandle) return {};
@@ -52,6 +57,13 @@ std::vector<MpqArchive::path> MpqArchive::findFiles(const path& searchMask)
     return list;
 }
 
+bool MpqArchive::listFiles(std::vector<path>& files)
+{
+    std::vector<path> found = findFiles();
+    files.insert(files.end(), found.begin(), found.end());
+    return false; // Files missing from the list files can not be found
+}
+
 bool MpqArchive::load()
 {
     if (mpqHandle) throw std::runtime_error("tried to reopen mpq archive");
@@ -64,12 +76,47 @@ bool MpqArchive::is_loaded() { return mpqHandle != nullptr; }
 
 bool MpqArchive::unload()
 {
+    assert(fileHandles.size() == fileHandlesCount && "All the files must be closed first");
+    for (HANDLE fileHandle : fileHandles)
+    {
+        SFileCloseArchive(fileHandle);
+    }
+    fileHandles.clear();
+    fileHandlesCount = 0;
     if (!(mpqHandle && SFileCloseArchive(mpqHandle))) setstate(failbit);
     mpqHandle = nullptr;
     return good();
 }
 
-bool MpqArchive::exists(const path& filePath) { return SFileHasFile(mpqHandle, filePath.c_str()); }
+bool MpqArchive::exists(const path& filePath)
+{
+    std::lock_guard<std::mutex> lock(queriesMutex);
+    return SFileHasFile(mpqHandle, filePath.c_str());
+}
+
+MpqArchive::HANDLE MpqArchive::acquireFileHandle()
+{
+    {
+        std::lock_guard<std::mutex> lock(fileHandlesMutex);
+        if (!fileHandles.empty()) {
+            HANDLE handle = fileHandles.back();
+            fileHandles.pop_back();
+            return handle;
+        }
+    }
+    // Each handle has its own copy of the tables and file stream, StormLib can not share them.
+    HANDLE handle = nullptr;
+    if (!SFileOpenArchive(mpqFileName.c_str(), 0, STREAM_FLAG_READ_ONLY, &handle)) return nullptr;
+    std::lock_guard<std::mutex> lock(fileHandlesMutex);
+    fileHandlesCount++;
+    return handle;
+}
+
+void MpqArchive::releaseFileHandle(HANDLE handle)
+{
+    std::lock_guard<std::mutex> lock(fileHandlesMutex);
+    fileHandles.push_back(handle);
+}
 
 StreamPtr MpqArchive::open(const path& filePath)
 {
@@ -81,10 +128,19 @@ MpqFileStream::MpqFileStream(MpqArchive& archive, const path& filename) { open(a
 
 MpqFileStream::~MpqFileStream() { close(); }
 
-bool MpqFileStream::open(MpqArchive& archive, const path& filename)
+bool MpqFileStream::open(MpqArchive& mpqArchive, const path& filename)
 {
-    if (!archive || !SFileOpenFileEx(archive.getInternalHandle(), filename.c_str(), 0, &file))
+    assert(!archiveHandle);
+    if (mpqArchive) archiveHandle = mpqArchive.acquireFileHandle();
+    if (!archiveHandle) {
+        setstate(failbit);
+        return false;
+    }
+    sourceArchive = &mpqArchive;
+    if (!SFileOpenFileEx(archiveHandle, filename.c_str(), 0, &file)) {
+        file = nullptr;
         setstate(failbit);
+    }
     return good();
 }
 
@@ -92,6 +148,9 @@ bool MpqFileStream::close()
 {
     if (!(file && SFileCloseFile(file))) setstate(failbit);
     file = nullptr;
+    if (archiveHandle) sourceArchive->releaseFileHandle(archiveHandle);
+    archiveHandle = nullptr;
+    sourceArchive = nullptr;
     return good();
 }
 
@@ -0,0 +1,738 @@
+/**
+ * @file NativeMpqArchive.cpp
+ * @author Lectem
+ */
+
+#include "NativeMpqArchive.h"
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <assert.h>
+#include <string.h>
+#ifdef WS_HAS_ZLIB
+#include <zlib.h>
+#endif
+
+namespace WorldStone
+{
+
+namespace
+{
+// Block flags
+const uint32_t MPQ_FILE_IMPLODE     = 0x00000100;
+const uint32_t MPQ_FILE_COMPRESS    = 0x00000200;
+const uint32_t MPQ_FILE_ENCRYPTED   = 0x00010000;
+const uint32_t MPQ_FILE_FIX_KEY     = 0x00020000;
+const uint32_t MPQ_FILE_SINGLE_UNIT = 0x01000000;
+const uint32_t MPQ_FILE_EXISTS      = 0x80000000;
+
+// Compression masks, first byte of the compressed sectors
+const uint8_t MPQ_COMPRESSION_ZLIB   = 0x02;
+const uint8_t MPQ_COMPRESSION_PKWARE = 0x08;
+
+const uint32_t MPQ_HEADER_MAGIC    = 0x1A51504D; // 'MPQ\x1A'
+const uint32_t MPQ_USERDATA_MAGIC  = 0x1B51504D; // 'MPQ\x1B'
+const uint32_t HASH_ENTRY_FREE     = 0xFFFFFFFF; ///< Ends the search in the hash table
+const uint32_t HASH_ENTRY_DELETED  = 0xFFFFFFFE; ///< The search must continue
+const size_t   HEADER_SEARCH_ALIGN = 512;
+
+enum HashType : uint32_t
+{
+    HASH_TABLE_OFFSET = 0,
+    HASH_NAME_A       = 1,
+    HASH_NAME_B       = 2,
+    HASH_FILE_KEY     = 3,
+};
+
+struct MpqUserDataHeader
+{
+    uint32_t magic;
+    uint32_t userDataSize;
+    uint32_t headerOffset; ///< Offset of the MPQ header, relative to the user data header
+    uint32_t userDataHeaderSize;
+};
+
+struct MpqHeader
+{
+    uint32_t magic;
+    uint32_t headerSize;
+    uint32_t archiveSize;
+    uint16_t formatVersion;
+    uint16_t sectorSizeShift; ///< The sector size is 512 << sectorSizeShift
+    uint32_t hashTablePos;
+    uint32_t blockTablePos;
+    uint32_t hashTableSize; ///< Number of entries
+    uint32_t blockTableSize;
+    // Format version 1
+    uint64_t hiBlockTablePos;
+    uint16_t hashTablePosHi;
+    uint16_t blockTablePosHi;
+};
+const size_t mpqHeaderV0Size = 32;
+const size_t mpqHeaderV1Size = 44;
+
+using CryptTable = std::array<uint32_t, 0x500>;
+
+CryptTable buildCryptTable()
+{
+    CryptTable table;
+    uint32_t   seed = 0x00100001;
+    for (uint32_t index1 = 0; index1 < 0x100; index1++)
+    {
+        for (uint32_t index2 = index1, i = 0; i < 5; i++, index2 += 0x100)
+        {
+            seed                 = (seed * 125 + 3) % 0x2AAAAB;
+            const uint32_t temp1 = (seed & 0xFFFF) << 0x10;
+            seed                 = (seed * 125 + 3) % 0x2AAAAB;
+            const uint32_t temp2 = (seed & 0xFFFF);
+            table[index2]        = temp1 | temp2;
+        }
+    }
+    return table;
+}
+
+const CryptTable& getCryptTable()
+{
+    // Thread-safe initialization, the table is then only read
+    static const CryptTable cryptTable = buildCryptTable();
+    return cryptTable;
+}
+
+/// Decrypt size / 4 dwords of data in place, the remaining bytes are not encrypted
+void decryptBlock(uint8_t* data, size_t size, uint32_t key)
+{
+    const CryptTable& cryptTable = getCryptTable();
+
+    uint32_t seed = 0xEEEEEEEE;
+    for (size_t offset = 0; offset + 4 <= size; offset += 4)
+    {
+        uint32_t value;
+        memcpy(&value, data + offset, sizeof(value));
+        seed += cryptTable[0x400 + (key & 0xFF)];
+        value ^= key + seed;
+        key  = ((~key << 0x15) + 0x11111111) | (key >> 0x0B);
+        seed = value + seed + (seed << 5) + 3;
+        memcpy(data + offset, &value, sizeof(value));
+    }
+}
+
+template<class Entry>
+bool readTable(const uint8_t* archiveData, size_t archiveSize, uint64_t tablePos,
+               uint32_t nbEntries, const char* keyName, Vector<Entry>& table)
+{
+    static_assert(sizeof(Entry) == 16, "MPQ table entries are 4 dwords");
+    const size_t tableSize = size_t(nbEntries) * sizeof(Entry);
+    if (tablePos > archiveSize || tableSize > archiveSize - tablePos) return false;
+    table.resize(nbEntries);
+    memcpy(table.data(), archiveData + tablePos, tableSize);
+    decryptBlock(reinterpret_cast<uint8_t*>(table.data()), tableSize,
+                 NativeMpqArchive::hashString(keyName, HASH_FILE_KEY));
+    return true;
+}
+
+/// Compute the encryption key of a file, which only depends on its name and not on its path
+uint32_t getFileKey(const char* filename, const NativeMpqArchive::BlockEntry& block)
+{
+    const char* name = filename;
+    for (const char* c = filename; *c; c++)
+    {
+        if (*c == '\\' || *c == '/') name = c + 1;
+    }
+    uint32_t key = NativeMpqArchive::hashString(name, HASH_FILE_KEY);
+    if (block.flags & MPQ_FILE_FIX_KEY) key = (key + block.filePos) ^ block.fileSize;
+    return key;
+}
+
+/**
+ * @brief Decompressor for the PKWARE Data Compression Library "implode" format.
+ *
+ * Port of blast.c from the zlib contrib folder, by Mark Adler, writing directly to the output.
+ */
+class Exploder
+{
+    static const int maxBits = 13; ///< Maximum number of bits of a code
+
+    /// Canonical Huffman code decoding tables
+    struct Huffman
+    {
+        short count[maxBits + 1]; ///< Number of symbols of each length
+        short symbol[256];        ///< Symbols ordered by code
+    };
+
+    const uint8_t* input;
+    const uint8_t* inputEnd;
+    uint32_t       bitBuffer = 0;
+    int            bitCount  = 0;
+    bool           overflow  = false; ///< Tried to read after the end of the input
+
+    /// Read `need` bits, least significant first
+    int bits(int need)
+    {
+        uint32_t value = bitBuffer;
+        while (bitCount < need)
+        {
+            if (input == inputEnd) {
+                overflow = true;
+                return 0;
+            }
+            value |= uint32_t(*input++) << bitCount;
+            bitCount += 8;
+        }
+        bitBuffer = value >> need;
+        bitCount -= need;
+        return int(value & ((1u << need) - 1));
+    }
+
+    /// Decode a symbol, the bits of the codes are inverted and stored most significant first
+    int decode(const Huffman& huffman)
+    {
+        int code  = 0; // Bits read so far
+        int first = 0; // First code of the current length
+        int index = 0; // Index of the first code of the current length in the symbol table
+        for (int len = 1; len <= maxBits; len++)
+        {
+            code |= bits(1) ^ 1;
+            if (overflow) return -1;
+            const int count = huffman.count[len];
+            if (code - first < count) return huffman.symbol[index + (code - first)];
+            index += count;
+            first += count;
+            first <<= 1;
+            code <<= 1;
+        }
+        return -1; // Ran out of codes
+    }
+
+    /**Build a decoding table from the compact representation of the code lengths.
+     * Each byte gives a length in its lower 4 bits, repeated (upper 4 bits + 1) times.
+     */
+    static Huffman construct(const uint8_t* rep, size_t repSize)
+    {
+        uint8_t length[256];
+        size_t  nbSymbols = 0;
+        for (size_t i = 0; i < repSize; i++)
+        {
+            const int repeat = (rep[i] >> 4) + 1;
+            for (int j = 0; j < repeat; j++)
+            {
+                length[nbSymbols++] = uint8_t(rep[i] & 15);
+            }
+        }
+        Huffman huffman = {};
+        for (size_t symbol = 0; symbol < nbSymbols; symbol++)
+        {
+            huffman.count[length[symbol]]++;
+        }
+        short offsets[maxBits + 1];
+        offsets[1] = 0;
+        for (int len = 1; len < maxBits; len++)
+        {
+            offsets[len + 1] = short(offsets[len] + huffman.count[len]);
+        }
+        for (size_t symbol = 0; symbol < nbSymbols; symbol++)
+        {
+            if (length[symbol]) huffman.symbol[offsets[length[symbol]]++] = short(symbol);
+        }
+        return huffman;
+    }
+
+    struct Tables
+    {
+        Huffman literals;
+        Huffman lengths;
+        Huffman distances;
+    };
+
+    static const Tables& getTables()
+    {
+        static const uint8_t litlen[] = {
+            11,  124, 8,   7,   28,  7,   188, 13,  76,  4,  10, 8,  12, 10, 12, 10, 8,  23, 8,
+            9,   7,   6,   7,   8,   7,   6,   55,  8,   23, 24, 12, 11, 7,  9,  11, 12, 6,  7,
+            22,  5,   7,   24,  6,   11,  9,   6,   7,   22, 7,  11, 38, 7,  9,  8,  25, 11, 8,
+            11,  9,   12,  8,   12,  5,   38,  5,   38,  5,  11, 7,  5,  6,  21, 6,  10, 53, 8,
+            7,   24,  10,  27,  44,  253, 253, 253, 252, 252, 252, 13, 12, 45, 12, 45, 12, 61, 12,
+            45,  44,  173};
+        static const uint8_t lenlen[]  = {2, 35, 36, 53, 38, 23};
+        static const uint8_t distlen[] = {2, 20, 53, 230, 247, 151, 248};
+        static const Tables  tables    = {construct(litlen, sizeof(litlen)),
+                                      construct(lenlen, sizeof(lenlen)),
+                                      construct(distlen, sizeof(distlen))};
+        return tables;
+    }
+
+public:
+    Exploder(const uint8_t* _input, size_t inputSize)
+        : input(_input), inputEnd(_input + inputSize)
+    {
+    }
+
+    /// @return The number of bytes written, stops when the output is full
+    size_t explode(uint8_t* output, size_t outputSize)
+    {
+        static const short base[16]  = {3, 2, 4, 5, 6, 7, 8, 9, 10, 12, 16, 24, 40, 72, 136, 264};
+        static const uint8_t extra[16] = {0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8};
+        const Tables&        tables    = getTables();
+
+        const int codedLiterals = bits(8);
+        const int dictBits      = bits(8);
+        if (overflow || codedLiterals > 1 || dictBits < 4 || dictBits > 6) return 0;
+
+        size_t written = 0;
+        while (written < outputSize)
+        {
+            if (bits(1)) {
+                const int lengthSymbol = decode(tables.lengths);
+                if (lengthSymbol < 0) break;
+                const int length = base[lengthSymbol] + bits(extra[lengthSymbol]);
+                if (length == 519) break; // End of stream
+                const int distBits = length == 2 ? 2 : dictBits;
+                const int distCode = decode(tables.distances);
+                if (distCode < 0) break;
+                const size_t distance = size_t((distCode << distBits) + bits(distBits) + 1);
+                if (overflow || distance > written) break;
+                // Byte per byte since the copy can overlap with itself
+                const size_t copyEnd = std::min(written + size_t(length), outputSize);
+                for (; written < copyEnd; written++)
+                {
+                    output[written] = output[written - distance];
+                }
+            }
+            else
+            {
+                const int literal = codedLiterals ? decode(tables.literals) : bits(8);
+                if (overflow || literal < 0) break;
+                output[written++] = uint8_t(literal);
+            }
+            if (overflow) break;
+        }
+        return written;
+    }
+};
+
+#ifdef WS_HAS_ZLIB
+bool inflateZlib(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize)
+{
+    uLongf destLen = uLongf(outputSize);
+    return uncompress(output, &destLen, input, uLong(inputSize)) == Z_OK && destLen == outputSize;
+}
+#endif
+
+/// Decompress a sector, the first byte of the input being the compression mask
+bool decompressSector(const uint8_t* input, size_t inputSize, uint8_t* output, size_t outputSize)
+{
+    if (inputSize < 1) return false;
+    const uint8_t compressionMask = input[0];
+    input++;
+    inputSize--;
+    switch (compressionMask)
+    {
+    case MPQ_COMPRESSION_PKWARE:
+        return Exploder{input, inputSize}.explode(output, outputSize) == outputSize;
+    case MPQ_COMPRESSION_ZLIB:
+#ifdef WS_HAS_ZLIB
+        return inflateZlib(input, inputSize, output, outputSize);
+#else
+        return false; // Built without zlib
+#endif
+    default: return false; // Unsupported compression, or combination of compressions
+    }
+}
+
+const uint8_t asciiToUpperSlash[256] = {
+    0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07, 0x08, 0x09, 0x0A, 0x0B, 0x0C, 0x0D, 0x0E, 0x0F,
+    0x10, 0x11, 0x12, 0x13, 0x14, 0x15, 0x16, 0x17, 0x18, 0x19, 0x1A, 0x1B, 0x1C, 0x1D, 0x1E, 0x1F,
+    0x20, 0x21, 0x22, 0x23, 0x24, 0x25, 0x26, 0x27, 0x28, 0x29, 0x2A, 0x2B, 0x2C, 0x2D, 0x2E, 0x5C,
+    0x30, 0x31, 0x32, 0x33, 0x34, 0x35, 0x36, 0x37, 0x38, 0x39, 0x3A, 0x3B, 0x3C, 0x3D, 0x3E, 0x3F,
+    0x40, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F,
+    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x5B, 0x5C, 0x5D, 0x5E, 0x5F,
+    0x60, 0x41, 0x42, 0x43, 0x44, 0x45, 0x46, 0x47, 0x48, 0x49, 0x4A, 0x4B, 0x4C, 0x4D, 0x4E, 0x4F,
+    0x50, 0x51, 0x52, 0x53, 0x54, 0x55, 0x56, 0x57, 0x58, 0x59, 0x5A, 0x7B, 0x7C, 0x7D, 0x7E, 0x7F,
+    0x80, 0x81, 0x82, 0x83, 0x84, 0x85, 0x86, 0x87, 0x88, 0x89, 0x8A, 0x8B, 0x8C, 0x8D, 0x8E, 0x8F,
+    0x90, 0x91, 0x92, 0x93, 0x94, 0x95, 0x96, 0x97, 0x98, 0x99, 0x9A, 0x9B, 0x9C, 0x9D, 0x9E, 0x9F,
+    0xA0, 0xA1, 0xA2, 0xA3, 0xA4, 0xA5, 0xA6, 0xA7, 0xA8, 0xA9, 0xAA, 0xAB, 0xAC, 0xAD, 0xAE, 0xAF,
+    0xB0, 0xB1, 0xB2, 0xB3, 0xB4, 0xB5, 0xB6, 0xB7, 0xB8, 0xB9, 0xBA, 0xBB, 0xBC, 0xBD, 0xBE, 0xBF,
+    0xC0, 0xC1, 0xC2, 0xC3, 0xC4, 0xC5, 0xC6, 0xC7, 0xC8, 0xC9, 0xCA, 0xCB, 0xCC, 0xCD, 0xCE, 0xCF,
+    0xD0, 0xD1, 0xD2, 0xD3, 0xD4, 0xD5, 0xD6, 0xD7, 0xD8, 0xD9, 0xDA, 0xDB, 0xDC, 0xDD, 0xDE, 0xDF,
+    0xE0, 0xE1, 0xE2, 0xE3, 0xE4, 0xE5, 0xE6, 0xE7, 0xE8, 0xE9, 0xEA, 0xEB, 0xEC, 0xED, 0xEE, 0xEF,
+    0xF0, 0xF1, 0xF2, 0xF3, 0xF4, 0xF5, 0xF6, 0xF7, 0xF8, 0xF9, 0xFA, 0xFB, 0xFC, 0xFD, 0xFE, 0xFF};
+} // anonymous namespace
+
+uint32_t NativeMpqArchive::hashString(const char* fileName, uint32_t hashType)
+{
+    const CryptTable& cryptTable = getCryptTable();
+
+    uint32_t seed1 = 0x7FED7FED;
+    uint32_t seed2 = 0xEEEEEEEE;
+    for (const char* c = fileName; *c; c++)
+    {
+        const uint32_t ch = asciiToUpperSlash[uint8_t(*c)];
+        seed1             = cryptTable[(hashType << 8) + ch] ^ (seed1 + seed2);
+        seed2             = ch + seed1 + seed2 + (seed2 << 5) + 3;
+    }
+    return seed1;
+}
+
+NativeMpqArchive::NativeMpqArchive(const path& MpqFileName) : mpqFileName(MpqFileName) { load(); }
+
+NativeMpqArchive::~NativeMpqArchive() { unload(); }
+
+bool NativeMpqArchive::load()
+{
+    assert(!mappedFile);
+    mappedFile = std::make_unique<MmapFileStream>(mpqFileName);
+    const size_t   mappedSize = size_t(mappedFile->size());
+    const uint8_t* mapping    = mappedFile->tryGetContiguousView(0, mappedSize);
+    if (!mappedFile->good() || !mapping) {
+        unload();
+        setstate(failbit);
+        return false;
+    }
+
+    // The header is aligned on 512 bytes, and can be preceded by some user data
+    MpqHeader header    = {};
+    size_t    headerPos = 0;
+    for (; headerPos + mpqHeaderV0Size <= mappedSize; headerPos += HEADER_SEARCH_ALIGN)
+    {
+        uint32_t magic;
+        memcpy(&magic, mapping + headerPos, sizeof(magic));
+        if (magic == MPQ_USERDATA_MAGIC && headerPos + sizeof(MpqUserDataHeader) <= mappedSize) {
+            MpqUserDataHeader userData;
+            memcpy(&userData, mapping + headerPos, sizeof(userData));
+            const size_t userHeaderPos = headerPos + userData.headerOffset;
+            if (userHeaderPos + mpqHeaderV0Size <= mappedSize) {
+                memcpy(&magic, mapping + userHeaderPos, sizeof(magic));
+                if (magic == MPQ_HEADER_MAGIC) {
+                    headerPos = userHeaderPos;
+                    break;
+                }
+            }
+        }
+        else if (magic == MPQ_HEADER_MAGIC)
+            break;
+    }
+    if (headerPos + mpqHeaderV0Size > mappedSize) {
+        unload();
+        setstate(failbit);
+        return false;
+    }
+    const bool hasV1Header = headerPos + mpqHeaderV1Size <= mappedSize;
+    memcpy(&header, mapping + headerPos, hasV1Header ? mpqHeaderV1Size : mpqHeaderV0Size);
+
+    static std::atomic<uint64_t> nextArchiveId{1};
+    archiveId   = nextArchiveId++;
+    archiveData = mapping + headerPos;
+    archiveSize = mappedSize - headerPos;
+    uint64_t hashTablePos  = header.hashTablePos;
+    uint64_t blockTablePos = header.blockTablePos;
+    if (header.formatVersion == 0 || header.headerSize < mpqHeaderV1Size) {
+        // Version 0 tables can not be bigger than what fits in the archive
+        header.hashTableSize &= 0x0FFFFFFF;
+        header.blockTableSize &= 0x0FFFFFFF;
+    }
+    else
+    {
+        hashTablePos |= uint64_t(header.hashTablePosHi) << 32;
+        blockTablePos |= uint64_t(header.blockTablePosHi) << 32;
+    }
+    const bool validHashTableSize =
+        header.hashTableSize && (header.hashTableSize & (header.hashTableSize - 1)) == 0;
+    // Check the shift first, as shifting by more than the size of the type is undefined
+    if (header.sectorSizeShift > 20 || !validHashTableSize
+        || !readTable(archiveData, archiveSize, hashTablePos, header.hashTableSize, "(hash table)",
+                      hashTable)
+        || !readTable(archiveData, archiveSize, blockTablePos, header.blockTableSize,
+                      "(block table)", blockTable))
+    {
+        unload();
+        setstate(failbit);
+        return false;
+    }
+    sectorSize = 512u << header.sectorSizeShift;
+    return good();
+}
+
+bool NativeMpqArchive::is_loaded() { return archiveData != nullptr; }
+
+bool NativeMpqArchive::unload()
+{
+    // The sectors can not be reused since ids are unique, free the memory now
+    if (archiveId && sectorCache) sectorCache->eraseArchive(archiveId);
+    archiveId   = 0;
+    filesOpened = false;
+    archiveData = nullptr;
+    archiveSize = 0;
+    sectorSize  = 0;
+    hashTable.clear();
+    blockTable.clear();
+    if (!(mappedFile && mappedFile->close())) setstate(failbit);
+    mappedFile.reset();
+    return good();
+}
+
+uint64_t NativeMpqArchive::fileNameHash(const char* fileName)
+{
+    return uint64_t(hashString(fileName, HASH_NAME_A)) << 32 | hashString(fileName, HASH_NAME_B);
+}
+
+const NativeMpqArchive::BlockEntry* NativeMpqArchive::findBlock(const path& filePath) const
+{
+    if (hashTable.empty()) return nullptr;
+    const char*    fileName = filePath.c_str();
+    const size_t   mask     = hashTable.size() - 1; // The size is a power of 2
+    const size_t   start    = hashString(fileName, HASH_TABLE_OFFSET) & mask;
+    const uint32_t hashA    = hashString(fileName, HASH_NAME_A);
+    const uint32_t hashB    = hashString(fileName, HASH_NAME_B);
+
+    const BlockEntry* found = nullptr;
+    for (size_t i = 0, index = start; i < hashTable.size(); i++, index = (index + 1) & mask)
+    {
+        const HashEntry& entry = hashTable[index];
+        if (entry.blockIndex == HASH_ENTRY_FREE) break;
+        if (entry.hashA != hashA || entry.hashB != hashB || entry.blockIndex == HASH_ENTRY_DELETED)
+            continue;
+        if (entry.blockIndex >= blockTable.size()) continue;
+        const BlockEntry& block = blockTable[entry.blockIndex];
+        if (!(block.flags & MPQ_FILE_EXISTS)) continue;
+        if (entry.locale == 0) return &block; // Neutral locale is preferred
+        if (!found) found = &block;
+    }
+    return found;
+}
+
+bool NativeMpqArchive::exists(const path& filePath) { return findBlock(filePath) != nullptr; }
+
+bool NativeMpqArchive::listFiles(std::vector<path>& files)
+{
+    StreamPtr listFile = open("(listfile)");
+    if (!listFile) return false;
+    std::string content(size_t(listFile->size()), '\0');
+    if (listFile->read(&content[0], content.size()) != content.size()) return false;
+
+    // Names are separated by new lines or semicolons
+    size_t nameStart = 0;
+    while (nameStart < content.size())
+    {
+        size_t nameEnd = content.find_first_of(";\r\n", nameStart);
+        if (nameEnd == std::string::npos) nameEnd = content.size();
+        if (nameEnd != nameStart) {
+            path name = content.substr(nameStart, nameEnd - nameStart);
+            if (findBlock(name)) files.push_back(std::move(name));
+        }
+        nameStart = nameEnd + 1;
+    }
+    return false; // Files missing from the list file can not be found
+}
+
+bool NativeMpqArchive::listFileNameHashes(std::vector<uint64_t>& hashes)
+{
+    if (hashTable.empty()) return false;
+    for (const HashEntry& entry : hashTable)
+    {
+        // Free and deleted entries are also out of the block table
+        if (entry.blockIndex >= blockTable.size()) continue;
+        if (!(blockTable[entry.blockIndex].flags & MPQ_FILE_EXISTS)) continue;
+        hashes.push_back(uint64_t(entry.hashA) << 32 | entry.hashB);
+    }
+    return true;
+}
+
+bool NativeMpqArchive::setSectorCache(SectorCache* cache)
+{
+    if (filesOpened) return false;
+    sectorCache = cache;
+    return true;
+}
+
+StreamPtr NativeMpqArchive::open(const path& filePath)
+{
+    filesOpened = true;
+    StreamPtr tmp = std::make_unique<NativeMpqFileStream>(*this, filePath);
+    return tmp->good() ? std::move(tmp) : nullptr;
+}
+
+NativeMpqFileStream::NativeMpqFileStream(NativeMpqArchive& archive, const path& filename)
+{
+    if (!open(archive, filename)) {
+        fileData = nullptr;
+        setstate(failbit);
+    }
+}
+
+NativeMpqFileStream::~NativeMpqFileStream() {}
+
+bool NativeMpqFileStream::open(NativeMpqArchive& archive, const path& filename)
+{
+    if (!archive) return false;
+    const NativeMpqArchive::BlockEntry* block = archive.findBlock(filename);
+    if (!block || block->filePos > archive.archiveSize) return false;
+
+    fileData   = archive.archiveData + block->filePos;
+    archiveId  = archive.archiveId;
+    blockIndex = uint32_t(block - archive.blockTable.data());
+    cache      = archive.sectorCache;
+    dataSize = std::min(size_t(block->compressedSize), archive.archiveSize - block->filePos);
+    fileSize = block->fileSize;
+    flags    = block->flags;
+    if (flags & MPQ_FILE_ENCRYPTED) key = getFileKey(filename.c_str(), *block);
+
+    const bool isCompressed = (flags & (MPQ_FILE_IMPLODE | MPQ_FILE_COMPRESS)) != 0;
+    isRaw                   = !isCompressed && !(flags & MPQ_FILE_ENCRYPTED);
+    if (isRaw) return fileSize <= dataSize;
+    if (!fileSize) return true;
+
+    if (flags & MPQ_FILE_SINGLE_UNIT) {
+        unitSize      = fileSize;
+        sectorOffsets = {0, uint32_t(dataSize)};
+        return true;
+    }
+    unitSize                = archive.sectorSize;
+    const size_t nbSectors  = (fileSize + unitSize - 1) / unitSize;
+    const size_t tableBytes = (nbSectors + 1) * sizeof(uint32_t);
+    sectorOffsets.resize(nbSectors + 1);
+    if (isCompressed) {
+        // The sector offset table is at the beginning of the file data
+        if (tableBytes > dataSize) return false;
+        memcpy(sectorOffsets.data(), fileData, tableBytes);
+        if (flags & MPQ_FILE_ENCRYPTED) {
+            decryptBlock(reinterpret_cast<uint8_t*>(sectorOffsets.data()), tableBytes, key - 1);
+        }
+        for (size_t sector = 0; sector < nbSectors; sector++)
+        {
+            if (sectorOffsets[sector] > sectorOffsets[sector + 1]) return false;
+        }
+        return sectorOffsets[nbSectors] <= dataSize;
+    }
+    // Only encrypted, sectors are stored one after the other
+    for (size_t sector = 0; sector <= nbSectors; sector++)
+    {
+        sectorOffsets[sector] = uint32_t(std::min(sector * unitSize, fileSize));
+    }
+    return fileSize <= dataSize;
+}
+
+size_t NativeMpqFileStream::sectorLength(size_t sector) const
+{
+    return std::min(unitSize, fileSize - sector * unitSize);
+}
+
+bool NativeMpqFileStream::decodeSector(size_t sector, uint8_t* destination)
+{
+    const uint8_t* source     = fileData + sectorOffsets[sector];
+    const size_t   sourceSize = sectorOffsets[sector + 1] - sectorOffsets[sector];
+    const size_t   length     = sectorLength(sector);
+    if (sourceSize > length) return false;
+
+    if (flags & MPQ_FILE_ENCRYPTED) {
+        scratch.resize(sourceSize);
+        memcpy(scratch.data(), source, sourceSize);
+        decryptBlock(scratch.data(), sourceSize, key + uint32_t(sector));
+        source = scratch.data();
+    }
+    // Sectors that could not be compressed are stored as is
+    if (sourceSize == length) {
+        memcpy(destination, source, length);
+        return true;
+    }
+    if (flags & MPQ_FILE_IMPLODE) {
+        return Exploder{source, sourceSize}.explode(destination, length) == length;
+    }
+    if (flags & MPQ_FILE_COMPRESS) return decompressSector(source, sourceSize, destination, length);
+    return false;
+}
+
+bool NativeMpqFileStream::readSector(size_t sector, uint8_t* destination)
+{
+    if (!cache) return decodeSector(sector, destination);
+    const size_t length = sectorLength(sector);
+    if (SectorCache::SectorPtr cached = cache->find(cacheKey(sector))) {
+        memcpy(destination, cached->data(), length);
+        return true;
+    }
+    if (!decodeSector(sector, destination)) return false;
+    cache->insert(cacheKey(sector),
+                  std::make_shared<const Vector<uint8_t>>(destination, destination + length));
+    return true;
+}
+
+SectorCache::SectorPtr NativeMpqFileStream::loadSector(size_t sector)
+{
+    if (cache) {
+        if (SectorCache::SectorPtr cached = cache->find(cacheKey(sector))) return cached;
+    }
+    auto decoded = std::make_shared<Vector<uint8_t>>(sectorLength(sector));
+    if (!decodeSector(sector, decoded->data())) return nullptr;
+    if (cache) cache->insert(cacheKey(sector), decoded);
+    return decoded;
+}
+
+size_t NativeMpqFileStream::read(void* buffer, size_t size)
+{
+    assert(is_open());
+    const size_t available = position < fileSize ? fileSize - position : 0;
+    const size_t toRead    = size < available ? size : available;
+    uint8_t*     output    = static_cast<uint8_t*>(buffer);
+
+    if (isRaw) {
+        if (toRead) memcpy(output, fileData + position, toRead);
+        position += toRead;
+        if (toRead != size) setstate(eofbit | failbit);
+        return toRead;
+    }
+
+    size_t readSize = 0;
+    while (readSize < toRead)
+    {
+        const size_t sector         = position / unitSize;
+        const size_t offsetInSector = position % unitSize;
+        const size_t length         = sectorLength(sector);
+        const size_t chunkSize      = std::min(length - offsetInSector, toRead - readSize);
+        if (chunkSize == length && sector != bufferedSector) {
+            // Whole sector, no need for an intermediate copy
+            if (!readSector(sector, output + readSize)) break;
+        }
+        else
+        {
+            if (sector != bufferedSector) {
+                bufferedSector = size_t(-1);
+                sectorBuffer   = loadSector(sector);
+                if (!sectorBuffer) break;
+                bufferedSector = sector;
+            }
+            memcpy(output + readSize, sectorBuffer->data() + offsetInSector, chunkSize);
+        }
+        position += chunkSize;
+        readSize += chunkSize;
+    }
+    if (readSize != toRead)
+        setstate(badbit | failbit); // Corrupted or unsupported data
+    else if (readSize != size)
+        setstate(eofbit | failbit);
+    return readSize;
+}
+
+bool NativeMpqFileStream::seek(long offset, IStream::seekdir origin)
+{
+    assert(is_open());
+    long base = 0;
+    switch (origin)
+    {
+    case beg: base = 0; break;
+    case cur: base = long(position); break;
+    case end: base = long(fileSize); break;
+    default: setstate(failbit); return false;
+    }
+    // Like fseek, seeking past the end is valid, but reading from there will fail.
+    if (offset < -base) {
+        setstate(failbit);
+        return false;
+    }
+    position = size_t(base + offset);
+    return good();
+}
+
+const uint8_t* NativeMpqFileStream::tryGetContiguousView(size_t offset, size_t size)
+{
+    if (!isRaw) return nullptr;
+    return (offset <= fileSize && size <= fileSize - offset) ? fileData + offset : nullptr;
+}
+}
@@ -0,0 +1,116 @@
+/**
+ * @file SectorCache.cpp
+ * @author Lectem
+ */
+
+#include "SectorCache.h"
+
+namespace WorldStone
+{
+
+const size_t SectorCache::defaultCapacity;
+
+SectorCache::SectorCache(size_t capacityInBytes) : capacity(capacityInBytes) {}
+
+SectorCache& SectorCache::global()
+{
+    static SectorCache globalCache;
+    return globalCache;
+}
+
+SectorCache::SectorPtr SectorCache::find(const Key& key)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    auto                        found = entries.find(key);
+    if (found == entries.end()) {
+        stats.misses++;
+        return nullptr;
+    }
+    stats.hits++;
+    lru.splice(lru.begin(), lru, found->second);
+    return found->second->sector;
+}
+
+void SectorCache::insert(const Key& key, SectorPtr sector)
+{
+    if (!sector) return;
+    const size_t sectorSize = sector->size();
+    std::lock_guard<std::mutex> lock(mutex);
+    if (sectorSize > capacity) return;
+    auto found = entries.find(key);
+    if (found != entries.end()) {
+        // Decoded by another stream at the same time, keep the one already in the cache
+        lru.splice(lru.begin(), lru, found->second);
+        return;
+    }
+    shrinkTo(capacity - sectorSize);
+    lru.push_front({key, std::move(sector)});
+    entries.emplace(key, lru.begin());
+    stats.entries++;
+    stats.bytes += sectorSize;
+}
+
+void SectorCache::eraseArchive(uint64_t archiveId)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    for (auto it = lru.begin(); it != lru.end();)
+    {
+        auto next = std::next(it);
+        if (it->key.archiveId == archiveId) erase(it);
+        it = next;
+    }
+}
+
+void SectorCache::clear()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    lru.clear();
+    entries.clear();
+    stats.entries = 0;
+    stats.bytes   = 0;
+}
+
+void SectorCache::setCapacity(size_t capacityInBytes)
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    capacity = capacityInBytes;
+    shrinkTo(capacity);
+}
+
+size_t SectorCache::getCapacity() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return capacity;
+}
+
+SectorCache::Stats SectorCache::getStats() const
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    return stats;
+}
+
+void SectorCache::resetStats()
+{
+    std::lock_guard<std::mutex> lock(mutex);
+    stats.hits      = 0;
+    stats.misses    = 0;
+    stats.evictions = 0;
+}
+
+void SectorCache::shrinkTo(size_t maxBytes)
+{
+    while (stats.bytes > maxBytes)
+    {
+        erase(std::prev(lru.end()));
+        stats.evictions++;
+    }
+}
+
+void SectorCache::erase(LruList::iterator entry)
+{
+    stats.entries--;
+    stats.bytes -= entry->sector->size();
+    entries.erase(entry->key);
+    lru.erase(entry);
+}
+} // namespace WorldStone
@@ -0,0 +1,116 @@
+/**
+ * @file ThreadPool.cpp
+ * @author Lectem
+ */
+
+#include "ThreadPool.h"
+#include <algorithm>
+
+namespace WorldStone
+{
+
+ThreadPool::ThreadPool(size_t nbThreads)
+{
+    nbThreads = std::max(nbThreads, size_t(1));
+    workers.reserve(nbThreads);
+    for (size_t i = 0; i < nbThreads; i++)
+    {
+        workers.emplace_back([this] { workerLoop(); });
+    }
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        stopping = true;
+    }
+    tasksCondition.notify_all();
+    for (std::thread& worker : workers)
+    {
+        worker.join();
+    }
+}
+
+void ThreadPool::push(std::function<void()>&& task)
+{
+    {
+        std::lock_guard<std::mutex> lock(tasksMutex);
+        tasks.push_back(std::move(task));
+    }
+    tasksCondition.notify_one();
+}
+
+void ThreadPool::workerLoop()
+{
+    for (;;)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(tasksMutex);
+            tasksCondition.wait(lock, [this] { return stopping || !tasks.empty(); });
+            // Finish the remaining tasks before stopping
+            if (tasks.empty()) return;
+            task = std::move(tasks.front());
+            tasks.pop_front();
+        }
+        task();
+    }
+}
+
+namespace
+{
+/// State shared between the caller of parallelFor and the helper tasks
+struct ParallelForState
+{
+    const std::function<void(size_t)>* func;
+    size_t                             count;
+    std::atomic<size_t>                nextIndex{0};
+    std::atomic<size_t>                nbDone{0};
+    std::mutex                         mutex;
+    std::condition_variable            doneCondition;
+    std::exception_ptr                 firstException;
+
+    /// Process indices until there is none left
+    void work()
+    {
+        for (size_t index = nextIndex++; index < count; index = nextIndex++)
+        {
+            try
+            {
+                (*func)(index);
+            }
+            catch (...)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                if (!firstException) firstException = std::current_exception();
+            }
+            if (++nbDone == count) {
+                std::lock_guard<std::mutex> lock(mutex);
+                doneCondition.notify_all();
+            }
+        }
+    }
+};
+} // anonymous namespace
+
+void ThreadPool::runParallelFor(size_t count, const std::function<void(size_t)>& func)
+{
+    auto state   = std::make_shared<ParallelForState>();
+    state->func  = &func;
+    state->count = count;
+
+    // Helpers that start after all the indices were processed return immediately, and never
+    // access func, which is why we do not need to wait for them.
+    const size_t nbHelpers = std::min(count - 1, size());
+    for (size_t i = 0; i < nbHelpers; i++)
+    {
+        push([state] { state->work(); });
+    }
+    state->work();
+
+    std::unique_lock<std::mutex> lock(state->mutex);
+    state->doneCondition.wait(lock, [&] { return state->nbDone == count; });
+    if (state->firstException) std::rethrow_exception(state->firstException);
+}
+} // namespace WorldStone
@@ -0,0 +1,159 @@
+/**
+ * @file VirtualFileSystem.cpp
+ * @author Lectem
+ */
+
+#include "VirtualFileSystem.h"
+#include <algorithm>
+#include "NativeMpqArchive.h"
+
+namespace WorldStone
+{
+
+VirtualFileSystem::~VirtualFileSystem() {}
+
+VirtualFileSystem::path VirtualFileSystem::normalizePath(const path& filePath)
+{
+    path normalized = filePath;
+    for (char& c : normalized)
+    {
+        // Do not use tolower, as it depends on the locale
+        if (c >= 'A' && c <= 'Z')
+            c = char(c - 'A' + 'a');
+        else if (c == '/')
+            c = '\\';
+    }
+    return normalized;
+}
+
+bool VirtualFileSystem::mount(std::unique_ptr<Archive> source, int priority,
+                              const std::vector<path>& fileNames)
+{
+    if (!source || !source->good()) return false;
+    sources.push_back({std::move(source), priority, false, fileNames});
+    indexSource(sources.size() - 1);
+    return true;
+}
+
+void VirtualFileSystem::rebuildIndex()
+{
+    index.clear();
+    hashIndex.clear();
+    probedSources.clear();
+    for (size_t sourceIndex = 0; sourceIndex < sources.size(); sourceIndex++)
+    {
+        indexSource(sourceIndex);
+    }
+}
+
+bool VirtualFileSystem::hides(size_t a, size_t b) const
+{
+    const int priorityA = sources[a].priority;
+    const int priorityB = sources[b].priority;
+    return priorityA > priorityB || (priorityA == priorityB && a > b);
+}
+
+void VirtualFileSystem::indexSource(size_t sourceIndex)
+{
+    Source&           source = sources[sourceIndex];
+    std::vector<path> fileNames;
+    source.completeList = source.archive->listFiles(fileNames);
+    for (const path& name : source.extraFileNames)
+    {
+        if (source.archive->exists(name)) fileNames.push_back(name);
+    }
+
+    index.reserve(index.size() + fileNames.size());
+    for (path& name : fileNames)
+    {
+        IndexEntry& entry = index[normalizePath(name)];
+        if (entry.sourcePath.empty() || hides(sourceIndex, entry.sourceIndex)) {
+            entry.sourceIndex = sourceIndex;
+            entry.sourcePath  = std::move(name);
+        }
+    }
+
+    // The hashes of the names are enough to know if a file is in the source
+    std::vector<uint64_t> hashes;
+    if (!source.completeList && source.archive->listFileNameHashes(hashes)) {
+        source.completeList = true;
+        hashIndex.reserve(hashIndex.size() + hashes.size());
+        for (uint64_t hash : hashes)
+        {
+            auto inserted = hashIndex.emplace(hash, sourceIndex);
+            if (!inserted.second && hides(sourceIndex, inserted.first->second))
+                inserted.first->second = sourceIndex;
+        }
+    }
+
+    if (!source.completeList) {
+        probedSources.push_back(sourceIndex);
+        std::sort(probedSources.begin(), probedSources.end(),
+                  [this](size_t a, size_t b) { return hides(a, b); });
+    }
+}
+
+bool VirtualFileSystem::locate(const path& filePath, size_t& sourceIndex, const path*& sourcePath)
+{
+    bool located = false;
+    auto found   = index.find(normalizePath(filePath));
+    if (found != index.end()) {
+        located     = true;
+        sourceIndex = found->second.sourceIndex;
+        sourcePath  = &found->second.sourcePath;
+    }
+    if (!hashIndex.empty()) {
+        auto hashed = hashIndex.find(NativeMpqArchive::fileNameHash(filePath.c_str()));
+        if (hashed != hashIndex.end() && (!located || hides(hashed->second, sourceIndex))) {
+            located     = true;
+            sourceIndex = hashed->second;
+            sourcePath  = &filePath;
+        }
+    }
+    // Unlisted sources may still hide the indexed one, but only if their priority is higher
+    for (size_t probedIndex : probedSources)
+    {
+        if (located && !hides(probedIndex, sourceIndex)) break;
+        if (sources[probedIndex].archive->exists(filePath)) {
+            sourceIndex = probedIndex;
+            sourcePath  = &filePath;
+            return true;
+        }
+    }
+    return located;
+}
+
+Archive* VirtualFileSystem::findSource(const path& filePath)
+{
+    size_t      sourceIndex = 0;
+    const path* sourcePath  = nullptr;
+    if (!locate(filePath, sourceIndex, sourcePath)) return nullptr;
+    return sources[sourceIndex].archive.get();
+}
+
+bool VirtualFileSystem::exists(const path& filePath) { return findSource(filePath) != nullptr; }
+
+StreamPtr VirtualFileSystem::open(const path& filePath)
+{
+    size_t      sourceIndex = 0;
+    const path* sourcePath  = nullptr;
+    if (!locate(filePath, sourceIndex, sourcePath)) return nullptr;
+    return sources[sourceIndex].archive->open(*sourcePath);
+}
+
+bool VirtualFileSystem::isThreadSafe()
+{
+    return std::all_of(sources.begin(), sources.end(),
+                       [](Source& source) { return source.archive->isThreadSafe(); });
+}
+
+bool VirtualFileSystem::listFiles(std::vector<path>& files)
+{
+    files.reserve(files.size() + index.size());
+    for (const auto& entry : index)
+    {
+        files.push_back(entry.second.sourcePath);
+    }
+    return probedSources.empty() && hashIndex.empty();
+}
+}
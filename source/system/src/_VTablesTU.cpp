@@ -12,6 +12,9 @@
 namespace WorldStone
 {
 Archive::~Archive() {}
+
+bool Archive::listFiles(std::vector<path>&) { return false; }
+bool Archive::listFileNameHashes(std::vector<uint64_t>&) { return false; }
 IStream::~IStream() {}
 
 int IStream::getc()
@@ -23,4 +26,6 @@ int IStream::getc()
     else
         return -1;
 }
+
+const uint8_t* IStream::tryGetContiguousView(size_t, size_t) { return nullptr; }
 }
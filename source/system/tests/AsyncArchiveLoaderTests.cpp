@@ -0,0 +1,138 @@
+/**
+ * @file AsyncArchiveLoaderTests.cpp
+ */
+#include <AsyncArchiveLoader.h>
+#include <MemoryStream.h>
+#include <NativeMpqArchive.h>
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <string.h>
+#include <thread>
+#include "doctest.h"
+
+using WorldStone::Archive;
+using WorldStone::AsyncArchiveLoader;
+using WorldStone::MemoryStream;
+using WorldStone::NativeMpqArchive;
+using WorldStone::StreamPtr;
+using WorldStone::Vector;
+
+namespace
+{
+/// An archive that is not thread-safe, whose files contain their own name
+class CountingArchive : public Archive
+{
+public:
+    CountingArchive() = default;
+
+    bool exists(const path& filePath) override { return filePath != "missing"; }
+    StreamPtr open(const path& filePath) override
+    {
+        // Do not use doctest assertions here, as they are not thread-safe
+        if (reading.exchange(true)) concurrentReads = true;
+        opens++;
+        if (filePath == "throw") {
+            reading = false;
+            throw std::runtime_error("Failed to open the file");
+        }
+        StreamPtr stream;
+        if (exists(filePath)) {
+            stream = std::make_unique<MemoryStream>(
+                Vector<uint8_t>(filePath.begin(), filePath.end()));
+        }
+        reading = false;
+        return stream;
+    }
+
+    std::atomic<size_t> opens{0};
+    std::atomic<bool>   concurrentReads{false};
+
+private:
+    bool load() override { return true; }
+    bool is_loaded() override { return true; }
+    bool unload() override { return true; }
+
+    std::atomic<bool> reading{false}; ///< Used to check that reads are serialized
+};
+
+std::string readAll(StreamPtr stream)
+{
+    REQUIRE(stream != nullptr);
+    std::string content(size_t(stream->size()), '\0');
+    CHECK(stream->read(&content[0], content.size()) == content.size());
+    return content;
+}
+
+/// Wait a bit for the I/O threads to reach the expected number of opens
+bool waitForOpens(const CountingArchive& archive, size_t expectedOpens)
+{
+    for (int i = 0; i < 500 && archive.opens < expectedOpens; i++)
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    // Give a chance to any unexpected read to happen
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    return archive.opens == expectedOpens;
+}
+} // anonymous namespace
+
+/// @testimpl{WorldStone::AsyncArchiveLoader,AsyncArchiveLoader}
+TEST_CASE("AsyncArchiveLoader")
+{
+    SUBCASE("Files are read in memory streams")
+    {
+        NativeMpqArchive mpq{"nativeMpqTest.mpq"};
+        REQUIRE(mpq.good());
+        AsyncArchiveLoader loader{mpq};
+
+        std::future<StreamPtr> raw      = loader.openAsync("raw.txt");
+        std::future<StreamPtr> imploded = loader.openAsync("imploded.txt");
+        std::future<StreamPtr> missing  = loader.openAsync("does-not-exist-file");
+        CHECK(readAll(raw.get()) == "stored without compression");
+        CHECK(readAll(imploded.get()) == "AIAIAIAIAIAIA");
+        CHECK(missing.get() == nullptr);
+
+        loader.prefetch({"single.txt", "raw.txt", "single.txt"});
+        CHECK(loader.getPrefetchedNumber() == 2);
+        CHECK(readAll(loader.openAsync("single.txt").get()).find("A single unit file, ") == 0);
+        CHECK(loader.getPrefetchedNumber() == 1);
+        // The loader can be destroyed with prefetched files that were not claimed
+    }
+    SUBCASE("Prefetched files are bounded by the budget")
+    {
+        CountingArchive            archive;
+        std::vector<Archive::path> files;
+        for (int i = 0; i < 10; i++)
+            files.push_back("file" + std::to_string(i));
+
+        AsyncArchiveLoader loader{archive, 4, 3};
+        loader.prefetch(files);
+        CHECK(loader.getPrefetchedNumber() == 10);
+        CHECK(waitForOpens(archive, 3));
+
+        // Claiming a prefetched file lets the next one be read
+        CHECK(readAll(loader.openAsync("file0").get()) == "file0");
+        CHECK(waitForOpens(archive, 4));
+
+        // Files still waiting for the budget are read as soon as they are needed
+        CHECK(readAll(loader.openAsync("file9").get()) == "file9");
+        CHECK(waitForOpens(archive, 5));
+        // As are the files that were not prefetched
+        CHECK(readAll(loader.openAsync("other").get()) == "other");
+        CHECK(waitForOpens(archive, 6));
+
+        CHECK_FALSE(archive.concurrentReads);
+
+        loader.cancelPrefetches();
+        CHECK(loader.getPrefetchedNumber() == 0);
+        loader.prefetch({"file5"});
+        CHECK(readAll(loader.openAsync("file5").get()) == "file5");
+    }
+    SUBCASE("Errors are given to the caller")
+    {
+        CountingArchive    archive;
+        AsyncArchiveLoader loader{archive};
+        CHECK(loader.openAsync("missing").get() == nullptr);
+        std::future<StreamPtr> failed = loader.openAsync("throw");
+        CHECK_THROWS_AS(failed.get(), std::runtime_error);
+    }
+}
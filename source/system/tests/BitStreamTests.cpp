@@ -12,10 +12,13 @@ using WorldStone::BitStreamView;
  */
 TEST_CASE("BitStreamView read.")
 {
-    const char buffer[] = {0x01, 0x23, 0x45, 0x67, (char)0x89, (char)0xAB, (char)0xCD, (char)0xEF};
-    BitStreamView bitstream{buffer, sizeof(buffer) * CHAR_BIT};
-    CHECK(bitstream.bufferSizeInBytes() == sizeof(buffer));
-    CHECK(bitstream.sizeInBits() == sizeof(buffer) * CHAR_BIT);
+    // The stream may read up to BitStreamView::tailPaddingBytes past its end
+    const char buffer[8 + BitStreamView::tailPaddingBytes] = {
+        0x01, 0x23, 0x45, 0x67, (char)0x89, (char)0xAB, (char)0xCD, (char)0xEF};
+    const size_t  bufferSize = 8;
+    BitStreamView bitstream{buffer, bufferSize * CHAR_BIT};
+    CHECK(bitstream.bufferSizeInBytes() == bufferSize);
+    CHECK(bitstream.sizeInBits() == bufferSize * CHAR_BIT);
     SUBCASE("Unsigned integer reads")
     {
         // clang-format off
@@ -125,3 +128,47 @@ TEST_CASE("BitStreamView read.")
     CHECK(bitstream.good());
     // TODO : set badbit on failure
 }
+
+/**Test that reads spanning multiple refills of the bit-buffer give the same values as reading
+ * the bits one by one.
+ * @testimpl{WorldStone::BitStreamView,RO_bitstream}
+ */
+TEST_CASE("BitStreamView refills.")
+{
+    const size_t bufferSize = 64;
+    uint8_t      buffer[bufferSize + BitStreamView::tailPaddingBytes] = {};
+    for (size_t i = 0; i < bufferSize; i++)
+    {
+        buffer[i] = uint8_t(i * 37u + 11u);
+    }
+    const auto referenceBit = [&](size_t bitPos) -> uint32_t {
+        return (buffer[bitPos / CHAR_BIT] >> (bitPos % CHAR_BIT)) & 1u;
+    };
+
+    BitStreamView bitstream{buffer, bufferSize * CHAR_BIT};
+    const unsigned readSizes[] = {3, 32, 1, 0, 17, 8, 29, 4, 2, 32, 7, 31, 5, 13, 24, 1, 32, 9};
+    size_t         bitPos      = 0;
+    for (int pass = 0; pass < 2; pass++) // 2 * 250 bits, fits in the 512 bits of the buffer
+    {
+        for (unsigned nbBits : readSizes)
+        {
+            uint32_t expected = 0;
+            for (unsigned bit = 0; bit < nbBits; bit++)
+            {
+                expected |= referenceBit(bitPos + bit) << bit;
+            }
+            CHECK(bitstream.readUnsigned(nbBits) == expected);
+            bitPos += nbBits;
+            CHECK(bitstream.tell() == bitPos);
+        }
+    }
+    SUBCASE("Changing the position discards the buffered bits")
+    {
+        bitstream.setPosition(13);
+        CHECK(bitstream.readUnsigned8OrLess(5) == ((buffer[1] >> 5) | (buffer[2] << 3)) % 32u);
+        bitstream.skip(100);
+        CHECK(bitstream.tell() == 118);
+        CHECK(bitstream.readBit() == referenceBit(118));
+    }
+    CHECK(bitstream.good());
+}
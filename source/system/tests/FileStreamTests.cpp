@@ -3,14 +3,19 @@
 */
 
 #include <FileStream.h>
+#include <MmapFileStream.h>
 #include <MpqArchive.h>
+#include <NativeMpqArchive.h>
 #include <fstream>
 #include <string.h>
 #include "doctest.h"
 
 using WorldStone::FileStream;
+using WorldStone::MmapFileStream;
 using WorldStone::MpqArchive;
 using WorldStone::MpqFileStream;
+using WorldStone::NativeMpqArchive;
+using WorldStone::NativeMpqFileStream;
 using WorldStone::StreamPtr;
 
 namespace
@@ -30,11 +35,30 @@ public:
 
     ~MpqFileWrapper() { close(); }
 };
+
+// Base class so that the archive is constructed before the stream
+struct NativeMpqArchiveHolder
+{
+    NativeMpqArchive archive{"testArchive.mpq"};
+};
+
+class NativeMpqWrapper : private NativeMpqArchiveHolder, public NativeMpqFileStream
+{
+public:
+    NativeMpqWrapper(const char* filename) : NativeMpqFileStream(archive, filename)
+    {
+        REQUIRE_MESSAGE(archive.good(), "This archive should be valid, wrong working directory ?");
+    }
+};
 }
-typedef doctest::Types<WorldStone::FileStream, MpqFileWrapper> stream_types;
+typedef doctest::Types<WorldStone::FileStream, MpqFileWrapper, WorldStone::MmapFileStream,
+                       NativeMpqWrapper>
+    stream_types;
 
 TYPE_TO_STRING(WorldStone::FileStream);
+TYPE_TO_STRING(WorldStone::MmapFileStream);
 TYPE_TO_STRING(MpqFileWrapper);
+TYPE_TO_STRING(NativeMpqWrapper);
 
 /// @testimpl{WorldStone::IStream,RO_filestreams}
 SCENARIO_TEMPLATE("Read-only filestreams", StreamType, stream_types)
@@ -163,3 +187,32 @@ SCENARIO_TEMPLATE("Read-only filestreams", StreamType, stream_types)
         }
     }
 }
+
+/// @testimpl{WorldStone::IStream,RO_filestreams}
+TEST_CASE("Contiguous views of streams")
+{
+    SUBCASE("Memory mapped files provide views inside the file")
+    {
+        MmapFileStream stream{"test.txt"};
+        REQUIRE(stream.is_open());
+        const uint8_t* view = stream.tryGetContiguousView(0, 4);
+        REQUIRE(view != nullptr);
+        CHECK(memcmp(view, "test", 4) == 0);
+        const uint8_t* subView = stream.tryGetContiguousView(1, 2);
+        REQUIRE(subView != nullptr);
+        CHECK(memcmp(subView, "es", 2) == 0);
+        CHECK(stream.tryGetContiguousView(4, 0) != nullptr);
+        CHECK(stream.tryGetContiguousView(0, 5) == nullptr);
+        CHECK(stream.tryGetContiguousView(5, 0) == nullptr);
+        // Does not change the stream state
+        CHECK(stream.tell() == 0);
+        CHECK(stream.good());
+    }
+    SUBCASE("Views are not supported by regular files")
+    {
+        FileStream stream{"test.txt"};
+        REQUIRE(stream.is_open());
+        CHECK(stream.tryGetContiguousView(0, 4) == nullptr);
+        CHECK(stream.good());
+    }
+}
@@ -0,0 +1,111 @@
+/**
+ * @file MemoryStreamTests.cpp
+ */
+
+#include <FileStream.h>
+#include <MemoryStream.h>
+#include <string.h>
+#include "doctest.h"
+
+using WorldStone::FileStream;
+using WorldStone::IStream;
+using WorldStone::MemoryStream;
+using WorldStone::SpanStream;
+
+/// @testimpl{WorldStone::SpanStream,RO_memorystreams}
+TEST_CASE("SpanStream reads")
+{
+    const char   content[] = "0123456789";
+    const size_t size      = sizeof(content) - 1;
+    SpanStream   stream{content, size};
+    IStream&     streamRef = stream; // Test it through the interface
+    REQUIRE(streamRef.good());
+    CHECK(streamRef.size() == long(size));
+    CHECK(streamRef.tell() == 0);
+
+    SUBCASE("Read and getc advance the position")
+    {
+        char buffer[4] = {};
+        CHECK(streamRef.read(buffer, 3) == 3);
+        CHECK(strncmp(buffer, "012", 3) == 0);
+        CHECK(streamRef.getc() == '3');
+        CHECK(streamRef.tell() == 4);
+        CHECK(streamRef.good());
+    }
+    SUBCASE("Reading past the end sets EOF and reports the number of bytes read")
+    {
+        char buffer[16] = {};
+        CHECK(streamRef.seek(-2, IStream::end));
+        CHECK(streamRef.read(buffer, sizeof(buffer)) == 2);
+        CHECK(strncmp(buffer, "89", 2) == 0);
+        CHECK(streamRef.eof());
+        CHECK(streamRef.fail());
+        CHECK_FALSE(streamRef.bad());
+    }
+    SUBCASE("getc at the end of the stream fails")
+    {
+        CHECK(streamRef.seek(long(size), IStream::beg));
+        CHECK(streamRef.getc() < 0);
+        CHECK(streamRef.eof());
+        CHECK(streamRef.fail());
+    }
+    SUBCASE("Seeking")
+    {
+        CHECK(streamRef.seek(5, IStream::beg));
+        CHECK(streamRef.seek(-2, IStream::cur));
+        CHECK(streamRef.getc() == '3');
+        CHECK(streamRef.seek(10, IStream::end)); // Past the end is valid, like fseek
+        CHECK(streamRef.good());
+        CHECK_FALSE(streamRef.seek(-1, IStream::beg));
+        CHECK(streamRef.fail());
+    }
+    SUBCASE("Views")
+    {
+        const uint8_t* contentBytes = reinterpret_cast<const uint8_t*>(content);
+        CHECK(streamRef.tryGetContiguousView(0, size) == contentBytes);
+        CHECK(streamRef.tryGetContiguousView(2, 3) == contentBytes + 2);
+        CHECK(streamRef.tryGetContiguousView(2, size) == nullptr);
+        CHECK(streamRef.tell() == 0);
+    }
+}
+
+/// @testimpl{WorldStone::MemoryStream,RO_memorystreams}
+TEST_CASE("MemoryStream owns its content")
+{
+    SUBCASE("Created from a buffer")
+    {
+        WorldStone::Vector<uint8_t> content{'a', 'b', 'c'};
+        const uint8_t*              contentData = content.data();
+        MemoryStream                stream{std::move(content)};
+        CHECK(stream.size() == 3);
+        CHECK(stream.getBuffer().data() == contentData); // No copy was made
+        CHECK(stream.getc() == 'a');
+
+        MemoryStream moved{std::move(stream)};
+        CHECK(moved.tell() == 1);
+        CHECK(moved.getc() == 'b');
+        CHECK(moved.good());
+        CHECK(stream.size() == 0);
+    }
+    SUBCASE("Created from another stream")
+    {
+        FileStream file{"test.txt"};
+        REQUIRE(file.is_open());
+        CHECK(file.getc() == 't');
+
+        MemoryStream stream{file};
+        REQUIRE(stream.good());
+        CHECK(file.tell() == file.size());
+        // Only the remaining content is copied
+        REQUIRE(stream.size() == 3);
+        char buffer[3] = {};
+        CHECK(stream.read(buffer, 3) == 3);
+        CHECK(strncmp(buffer, "est", 3) == 0);
+
+        CHECK(file.seek(0, IStream::beg));
+        CHECK(stream.readFrom(file));
+        CHECK(stream.tell() == 0);
+        CHECK(stream.size() == 4);
+        CHECK(stream.good());
+    }
+}
@@ -0,0 +1,58 @@
+/**
+ * @file MpqArchiveTests.cpp
+ */
+#include <MpqArchive.h>
+#include <ThreadPool.h>
+#include <atomic>
+#include <string.h>
+#include "doctest.h"
+
+using WorldStone::MpqArchive;
+using WorldStone::StreamPtr;
+using WorldStone::ThreadPool;
+using WorldStone::Vector;
+
+/// @testimpl{WorldStone::MpqArchive,MpqArchive}
+TEST_CASE("MpqArchive files can be read from multiple threads")
+{
+    MpqArchive archive{"testArchive.mpq"};
+    REQUIRE_MESSAGE(archive.good(), "This archive should be valid, wrong working directory ?");
+    CHECK(archive.isThreadSafe());
+
+    SUBCASE("Multiple files opened at the same time")
+    {
+        Vector<StreamPtr> streams;
+        for (int i = 0; i < 4; i++)
+        {
+            streams.push_back(archive.open("test.txt"));
+            REQUIRE(streams.back() != nullptr);
+        }
+        // Interleave the reads, each stream must keep its own position
+        for (size_t offset = 0; offset < 4; offset++)
+        {
+            for (StreamPtr& stream : streams)
+            {
+                CHECK(stream->getc() == "test"[offset]);
+            }
+        }
+    }
+    SUBCASE("Files opened and read concurrently")
+    {
+        ThreadPool       pool{4};
+        std::atomic<int> nbValidReads{0};
+        const size_t     nbReads = 64;
+        // Do not use the test macros from the workers
+        pool.parallelFor(nbReads, [&](size_t) {
+            if (!archive.exists("test.txt")) return;
+            StreamPtr stream = archive.open("test.txt");
+            if (!stream) return;
+            char buffer[4];
+            if (stream->read(buffer, sizeof(buffer)) == sizeof(buffer) &&
+                memcmp(buffer, "test", sizeof(buffer)) == 0)
+            {
+                nbValidReads++;
+            }
+        });
+        CHECK(nbValidReads == nbReads);
+    }
+}
@@ -0,0 +1,219 @@
+/**
+ * @file NativeMpqArchiveTests.cpp
+ */
+#include <NativeMpqArchive.h>
+#include <ThreadPool.h>
+#include <algorithm>
+#include <atomic>
+#include <string.h>
+#include "doctest.h"
+
+using WorldStone::NativeMpqArchive;
+using WorldStone::StreamPtr;
+using WorldStone::ThreadPool;
+using WorldStone::Vector;
+
+namespace
+{
+Vector<uint8_t> readWholeFile(NativeMpqArchive& archive, const char* filename)
+{
+    StreamPtr stream = archive.open(filename);
+    REQUIRE_MESSAGE(stream != nullptr, filename);
+    Vector<uint8_t> content(size_t(stream->size()));
+    CHECK(stream->read(content.data(), content.size()) == content.size());
+    CHECK(stream->good());
+    return content;
+}
+
+bool contentIs(const Vector<uint8_t>& content, const char* expected)
+{
+    return content.size() == strlen(expected) &&
+           memcmp(content.data(), expected, content.size()) == 0;
+}
+
+/// Same content as the file "data\encrypted.bin" of nativeMpqTest.mpq
+Vector<uint8_t> expectedEncryptedBin()
+{
+    Vector<uint8_t> content;
+    const char*     pattern = "worldstone ";
+    for (size_t i = 0; i < 512; i++)
+    {
+        content.push_back(uint8_t(pattern[i % strlen(pattern)]));
+    }
+    // Followed by 512 bytes that do not compress, see noise() in generateNativeMpqTest.py
+    uint32_t state = 1234;
+    for (size_t i = 0; i < 512; i++)
+    {
+        state = state * 1103515245u + 12345u;
+        content.push_back(uint8_t(state >> 24));
+    }
+    // Then 0-255 and zeros
+    for (size_t i = 0; i < 256; i++)
+    {
+        content.push_back(uint8_t(i));
+    }
+    content.resize(1300);
+    return content;
+}
+} // anonymous namespace
+
+/// @testimpl{WorldStone::NativeMpqArchive,NativeMpqArchive}
+TEST_CASE("NativeMpqArchive reads the same files as StormLib")
+{
+    NativeMpqArchive archive{"testArchive.mpq"};
+    REQUIRE_MESSAGE(archive.good(), "This archive should be valid, wrong working directory ?");
+    CHECK(archive.isThreadSafe());
+    CHECK(archive.getSectorSize() == 4096);
+
+    SUBCASE("Files are found regardless of the case and separators")
+    {
+        CHECK(archive.exists("test.txt"));
+        CHECK(archive.exists("TEST.TXT"));
+        CHECK(archive.exists("subfolder1\\insubfolder1.txt"));
+        CHECK(archive.exists("subfolder1/insubfolder1.txt"));
+        CHECK_FALSE(archive.exists("does-not-exist-file"));
+        CHECK_FALSE(archive.exists("insubfolder1.txt"));
+        CHECK(archive.open("does-not-exist-file") == nullptr);
+    }
+    SUBCASE("Content of the files")
+    {
+        CHECK(contentIs(readWholeFile(archive, "test.txt"), "test"));
+        CHECK(contentIs(readWholeFile(archive, "subfolder1\\insubfolder1.txt"), "insubfolder1"));
+#ifdef WS_HAS_ZLIB
+        // Compressed with zlib
+        CHECK(contentIs(readWholeFile(archive, "(listfile)"),
+                        "subfolder1\\insubfolder1.txt\r\ntest.txt\r\n"));
+        std::vector<NativeMpqArchive::path> files;
+        CHECK_FALSE(archive.listFiles(files)); // The list file might be incomplete
+        CHECK(files == std::vector<NativeMpqArchive::path>{"subfolder1\\insubfolder1.txt",
+                                                           "test.txt"});
+#endif
+    }
+    SUBCASE("Files opened and read concurrently")
+    {
+        ThreadPool       pool{4};
+        std::atomic<int> nbValidReads{0};
+        const size_t     nbReads = 64;
+        // Do not use the test macros from the workers
+        pool.parallelFor(nbReads, [&](size_t) {
+            if (!archive.exists("test.txt")) return;
+            StreamPtr stream = archive.open("test.txt");
+            if (!stream) return;
+            char buffer[4];
+            if (stream->read(buffer, sizeof(buffer)) == sizeof(buffer) &&
+                memcmp(buffer, "test", sizeof(buffer)) == 0)
+            {
+                nbValidReads++;
+            }
+        });
+        CHECK(nbValidReads == nbReads);
+    }
+    SUBCASE("Invalid archives")
+    {
+        NativeMpqArchive missingArchive{"does-not-exist-file"};
+        CHECK(missingArchive.fail());
+        CHECK_FALSE(missingArchive.exists("test.txt"));
+        CHECK(missingArchive.open("test.txt") == nullptr);
+        NativeMpqArchive notAnArchive{"test.txt"};
+        CHECK(notAnArchive.fail());
+        NativeMpqArchive badSectorShift{"nativeMpqBadSectorShift.mpq"};
+        CHECK(badSectorShift.fail());
+        CHECK_FALSE(badSectorShift.exists("raw.txt"));
+    }
+}
+
+/// @testimpl{WorldStone::NativeMpqArchive,NativeMpqArchive}
+TEST_CASE("NativeMpqArchive storage formats")
+{
+    // Generated archive with 512 bytes sectors, preceded by 512 bytes of garbage
+    NativeMpqArchive archive{"nativeMpqTest.mpq"};
+    REQUIRE_MESSAGE(archive.good(), "This archive should be valid, wrong working directory ?");
+    CHECK(archive.getSectorSize() == 512);
+
+    SUBCASE("PKWARE imploded file")
+    {
+        CHECK(contentIs(readWholeFile(archive, "imploded.txt"), "AIAIAIAIAIAIA"));
+    }
+    SUBCASE("Encrypted file with an adjusted key, using compressed and stored sectors")
+    {
+        const Vector<uint8_t> content  = readWholeFile(archive, "data\\encrypted.bin");
+        const Vector<uint8_t> expected = expectedEncryptedBin();
+        // The second sector does not compress, so it is stored as is but still encrypted
+        REQUIRE(content.size() == expected.size());
+        CHECK(memcmp(content.data(), expected.data(), 512) == 0);
+        CHECK(memcmp(content.data() + 512, expected.data() + 512, 512) == 0);
+        CHECK(memcmp(content.data() + 1024, expected.data() + 1024, 1300 - 1024) == 0);
+
+        SUBCASE("Reads that do not cover whole sectors")
+        {
+            StreamPtr stream = archive.open("data/encrypted.bin");
+            REQUIRE(stream != nullptr);
+            for (long offset : {1000L, 5L, 900L, 510L})
+            {
+                CAPTURE(offset);
+                uint8_t buffer[300];
+                REQUIRE(stream->seek(offset, WorldStone::IStream::beg));
+                REQUIRE(stream->read(buffer, sizeof(buffer)) == sizeof(buffer));
+                CHECK(memcmp(buffer, content.data() + offset, sizeof(buffer)) == 0);
+                CHECK(stream->tell() == offset + long(sizeof(buffer)));
+            }
+            REQUIRE(stream->seek(-4, WorldStone::IStream::end));
+            uint8_t tail[8];
+            CHECK(stream->read(tail, sizeof(tail)) == 4);
+            CHECK(stream->eof());
+            CHECK_FALSE(stream->bad());
+        }
+    }
+    SUBCASE("Encrypted and compressed single unit file")
+    {
+        const Vector<uint8_t> content = readWholeFile(archive, "single.txt");
+        REQUIRE(content.size() == 160);
+        for (size_t i = 0; i < 8; i++)
+        {
+            CHECK(memcmp(content.data() + i * 20, "A single unit file, ", 20) == 0);
+        }
+    }
+    SUBCASE("Encrypted only file")
+    {
+        const Vector<uint8_t> content = readWholeFile(archive, "encryptedonly.bin");
+        REQUIRE(content.size() == 700);
+        bool sameContent = true;
+        for (size_t i = 0; i < content.size(); i++)
+        {
+            sameContent &= content[i] == uint8_t(i * 7);
+        }
+        CHECK(sameContent);
+    }
+    SUBCASE("Files stored without compression can be viewed directly")
+    {
+        StreamPtr stream = archive.open("raw.txt");
+        REQUIRE(stream != nullptr);
+        const uint8_t* view = stream->tryGetContiguousView(0, 26);
+        REQUIRE(view != nullptr);
+        CHECK(memcmp(view, "stored without compression", 26) == 0);
+        CHECK(stream->tryGetContiguousView(0, 27) == nullptr);
+
+        StreamPtr compressedStream = archive.open("single.txt");
+        REQUIRE(compressedStream != nullptr);
+        CHECK(compressedStream->tryGetContiguousView(0, 1) == nullptr);
+    }
+    SUBCASE("The neutral locale is preferred")
+    {
+        CHECK(contentIs(readWholeFile(archive, "locale.txt"), "neutral"));
+    }
+    SUBCASE("Hashes of the names of the files")
+    {
+        std::vector<uint64_t> hashes;
+        CHECK(archive.listFileNameHashes(hashes));
+        // One for each entry of the hash table, and locale.txt has two of them
+        CHECK(hashes.size() == 7);
+        for (const char* fileName : {"imploded.txt", "DATA/encrypted.bin", "locale.txt"})
+        {
+            CAPTURE(fileName);
+            CHECK(std::count(hashes.begin(), hashes.end(),
+                             NativeMpqArchive::fileNameHash(fileName)) >= 1);
+        }
+        CHECK(std::count(hashes.begin(), hashes.end(),
+                         NativeMpqArchive::fileNameHash("does-not-exist-file")) == 0);
+    }
+}
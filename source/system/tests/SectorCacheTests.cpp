@@ -0,0 +1,135 @@
+/**
+ * @file SectorCacheTests.cpp
+ */
+#include <NativeMpqArchive.h>
+#include <SectorCache.h>
+#include <string.h>
+#include "doctest.h"
+
+using WorldStone::NativeMpqArchive;
+using WorldStone::SectorCache;
+using WorldStone::StreamPtr;
+using WorldStone::Vector;
+
+namespace
+{
+SectorCache::SectorPtr makeSector(size_t size, uint8_t value)
+{
+    return std::make_shared<const Vector<uint8_t>>(size, value);
+}
+} // anonymous namespace
+
+/// @testimpl{WorldStone::SectorCache,SectorCache}
+TEST_CASE("SectorCache")
+{
+    SUBCASE("Least recently used sectors are evicted first")
+    {
+        SectorCache            cache{300};
+        const SectorCache::Key keyA = {1, 0, 0}, keyB = {1, 0, 1}, keyC = {2, 0, 0};
+        cache.insert(keyA, makeSector(100, 'a'));
+        cache.insert(keyB, makeSector(100, 'b'));
+        CHECK(cache.getStats().bytes == 200);
+
+        // Touch A so that B is the least recently used one
+        REQUIRE(cache.find(keyA) != nullptr);
+        SectorCache::SectorPtr sectorB = cache.find(keyB);
+        REQUIRE(sectorB != nullptr);
+        CHECK(cache.find(keyA) != nullptr);
+        cache.insert(keyC, makeSector(150, 'c'));
+
+        CHECK(cache.find(keyB) == nullptr);
+        CHECK(cache.find(keyA) != nullptr);
+        REQUIRE(cache.find(keyC) != nullptr);
+        CHECK(cache.find(keyC)->front() == 'c');
+        // Evicted sectors stay valid for their users
+        CHECK(sectorB->front() == 'b');
+
+        const SectorCache::Stats stats = cache.getStats();
+        CHECK(stats.hits == 6);
+        CHECK(stats.misses == 1);
+        CHECK(stats.evictions == 1);
+        CHECK(stats.entries == 2);
+        CHECK(stats.bytes == 250);
+
+        cache.resetStats();
+        CHECK(cache.getStats().hits == 0);
+        CHECK(cache.getStats().entries == 2);
+    }
+    SUBCASE("Capacity")
+    {
+        SectorCache cache{100};
+        cache.insert({1, 0, 0}, makeSector(101, 0));
+        CHECK(cache.find({1, 0, 0}) == nullptr); // Too big to be cached
+        cache.insert({1, 0, 0}, makeSector(60, 0));
+        cache.insert({1, 0, 1}, makeSector(40, 0));
+        CHECK(cache.getStats().entries == 2);
+        cache.setCapacity(50);
+        CHECK(cache.getStats().entries == 1);
+        CHECK(cache.find({1, 0, 1}) != nullptr);
+        cache.setCapacity(0);
+        CHECK(cache.getStats().bytes == 0);
+    }
+    SUBCASE("Sectors of an archive can be removed")
+    {
+        SectorCache cache{1000};
+        cache.insert({1, 0, 0}, makeSector(10, 0));
+        cache.insert({1, 3, 0}, makeSector(10, 0));
+        cache.insert({2, 0, 0}, makeSector(10, 0));
+        cache.eraseArchive(1);
+        CHECK(cache.getStats().entries == 1);
+        CHECK(cache.find({2, 0, 0}) != nullptr);
+        cache.clear();
+        CHECK(cache.getStats().entries == 0);
+    }
+    SUBCASE("Used by NativeMpqArchive")
+    {
+        SectorCache      cache{1024 * 1024};
+        NativeMpqArchive archive{"nativeMpqTest.mpq"};
+        REQUIRE_MESSAGE(archive.good(), "This archive should be valid, wrong working directory ?");
+        CHECK(archive.getSectorCache() == &SectorCache::global());
+        CHECK(archive.setSectorCache(&cache));
+
+        Vector<uint8_t> firstRead(1300), secondRead(1300);
+        {
+            StreamPtr stream = archive.open("data\\encrypted.bin");
+            REQUIRE(stream != nullptr);
+            REQUIRE(stream->read(firstRead.data(), firstRead.size()) == firstRead.size());
+        }
+        CHECK(cache.getStats().misses == 3);
+        CHECK(cache.getStats().entries == 3);
+        {
+            // Reopening the file, and seeking backwards, does not decode the sectors again
+            StreamPtr stream = archive.open("data\\encrypted.bin");
+            REQUIRE(stream != nullptr);
+            REQUIRE(stream->read(secondRead.data(), secondRead.size()) == secondRead.size());
+            uint8_t buffer[10];
+            REQUIRE(stream->seek(600, WorldStone::IStream::beg));
+            REQUIRE(stream->read(buffer, sizeof(buffer)) == sizeof(buffer));
+            CHECK(memcmp(buffer, firstRead.data() + 600, sizeof(buffer)) == 0);
+        }
+        CHECK(secondRead == firstRead);
+        CHECK(cache.getStats().misses == 3);
+        CHECK(cache.getStats().hits == 4);
+
+        // Raw files are read from the mapping and do not need the cache
+        StreamPtr rawStream = archive.open("raw.txt");
+        REQUIRE(rawStream != nullptr);
+        char rawContent[26];
+        REQUIRE(rawStream->read(rawContent, sizeof(rawContent)) == sizeof(rawContent));
+        CHECK(cache.getStats().entries == 3);
+
+        // The cache can not be changed once files were opened, unloading could not clear it
+        CHECK_FALSE(archive.setSectorCache(nullptr));
+        CHECK(archive.getSectorCache() == &cache);
+
+        NativeMpqArchive uncachedArchive{"nativeMpqTest.mpq"};
+        REQUIRE(uncachedArchive.good());
+        CHECK(uncachedArchive.setSectorCache(nullptr));
+        const SectorCache::Stats globalStats    = SectorCache::global().getStats();
+        StreamPtr                uncachedStream = uncachedArchive.open("single.txt");
+        REQUIRE(uncachedStream != nullptr);
+        CHECK(uncachedStream->getc() == 'A');
+        CHECK(SectorCache::global().getStats().entries == globalStats.entries);
+        CHECK(SectorCache::global().getStats().misses == globalStats.misses);
+    }
+}
@@ -1,9 +1,11 @@
 /**
  * @file SystemUtilsTests.cpp
  */
+#include <CpuFeatures.h>
 #include <SystemUtils.h>
 #include <doctest.h>
 
+using WorldStone::CpuFeatures;
 using WorldStone::Utils::signExtend;
 /**Test that SignExtend is giving the right values
  * @testimpl{WorldStone::Utils::signExtend(),SignExtend}
@@ -71,3 +73,17 @@ TEST_CASE("PopCount 16bits")
     CHECK(popCount(uint64_t(0x000000000000FF00)) == 8);
     CHECK(popCount(uint64_t(0xFFFFFFFFFFFFFFFF)) == 64);
 }
+
+/// @testimpl{WorldStone::CpuFeatures,CpuFeatures}
+TEST_CASE("CpuFeatures")
+{
+    const CpuFeatures& features = CpuFeatures::get();
+    CHECK(&features == &CpuFeatures::get()); // Detected only once
+    // Instruction sets are supersets of the previous ones
+    CHECK((!features.avx2 || features.sse41));
+    CHECK((!features.sse41 || features.ssse3));
+    CHECK((!features.ssse3 || features.sse2));
+#if defined(WS_X86) && defined(WS_64BITS)
+    CHECK(features.sse2); // Part of the x86_64 baseline
+#endif
+}
@@ -0,0 +1,62 @@
+/**
+ * @file ThreadPoolTests.cpp
+ */
+#include <ThreadPool.h>
+#include <Vector.h>
+#include <atomic>
+#include <stdexcept>
+#include "doctest.h"
+
+using WorldStone::ThreadPool;
+using WorldStone::Vector;
+
+/**Test that tasks are run and that parallelFor visits every index once.
+ * @testimpl{WorldStone::ThreadPool,ThreadPool}
+ */
+TEST_CASE("ThreadPool")
+{
+    ThreadPool pool{4};
+    CHECK(pool.size() == 4);
+    SUBCASE("Enqueued tasks return their results through futures")
+    {
+        Vector<std::future<int>> results;
+        for (int i = 0; i < 32; i++)
+        {
+            results.push_back(pool.enqueue([i] { return i * i; }));
+        }
+        for (int i = 0; i < 32; i++)
+        {
+            CHECK(results[size_t(i)].get() == i * i);
+        }
+    }
+    SUBCASE("parallelFor calls the function once per index")
+    {
+        const size_t             count = 1000;
+        Vector<std::atomic<int>> calls(count);
+        pool.parallelFor(count, [&](size_t index) { calls[index]++; });
+        bool allCalledOnce = true;
+        for (const std::atomic<int>& nbCalls : calls)
+        {
+            allCalledOnce = allCalledOnce && nbCalls == 1;
+        }
+        CHECK(allCalledOnce);
+    }
+    SUBCASE("Nested parallelFor does not deadlock")
+    {
+        std::atomic<size_t> total{0};
+        pool.parallelFor(8, [&](size_t) {
+            pool.parallelFor(8, [&](size_t index) { total += index; });
+        });
+        CHECK(total == 8 * (0 + 1 + 2 + 3 + 4 + 5 + 6 + 7));
+    }
+    SUBCASE("Exceptions are forwarded to the caller")
+    {
+        CHECK_THROWS_AS(pool.parallelFor(16,
+                                         [](size_t index) {
+                                             if (index == 7) throw std::runtime_error("error");
+                                         }),
+                        std::runtime_error);
+        std::future<void> failingTask = pool.enqueue([] { throw std::runtime_error("error"); });
+        CHECK_THROWS_AS(failingTask.get(), std::runtime_error);
+    }
+}
@@ -0,0 +1,248 @@
+/**
+ * @file VirtualFileSystemTests.cpp
+ */
+#include <DirectoryArchive.h>
+#include <NativeMpqArchive.h>
+#include <VirtualFileSystem.h>
+#include <algorithm>
+#include <stdio.h>
+#include <string.h>
+#include "doctest.h"
+
+#ifndef _WIN32
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using WorldStone::Archive;
+using WorldStone::DirectoryArchive;
+using WorldStone::NativeMpqArchive;
+using WorldStone::StreamPtr;
+using WorldStone::VirtualFileSystem;
+
+namespace
+{
+// Reading the list file of testArchive.mpq needs zlib, so give the names in any case
+const std::vector<Archive::path> testArchiveFiles = {"test.txt", "subfolder1\\insubfolder1.txt"};
+
+/// Gives access to the files of an archive without listing them, like an MPQ without list file
+class UnlistedArchive : public Archive
+{
+public:
+    /// @param listHashes If true, the hashes of the names are still listed, like NativeMpqArchive
+    explicit UnlistedArchive(std::unique_ptr<Archive> source, bool listHashes = false)
+        : archive(std::move(source)), withHashes(listHashes)
+    {
+        if (archive->fail()) setstate(failbit);
+    }
+
+    bool exists(const path& filePath) override
+    {
+        existsCalls++;
+        return archive->exists(filePath);
+    }
+    StreamPtr open(const path& filePath) override { return archive->open(filePath); }
+    bool listFileNameHashes(std::vector<uint64_t>& hashes) override
+    {
+        return withHashes && archive->listFileNameHashes(hashes);
+    }
+
+    size_t existsCalls = 0;
+
+private:
+    bool load() override { return good(); }
+    bool is_loaded() override { return true; }
+    bool unload() override { return good(); }
+
+    std::unique_ptr<Archive> archive;
+    bool                     withHashes;
+};
+
+bool contains(const std::vector<Archive::path>& files, const char* name)
+{
+    return std::find(files.begin(), files.end(), name) != files.end();
+}
+} // anonymous namespace
+
+/// @testimpl{WorldStone::DirectoryArchive,VirtualFileSystem}
+TEST_CASE("DirectoryArchive")
+{
+    DirectoryArchive directory{"./"};
+    REQUIRE_MESSAGE(directory.good(), "The working directory should be valid");
+    CHECK(directory.exists("test.txt"));
+    CHECK(directory.exists("subfolder1\\insubfolder1.txt"));
+    CHECK(directory.exists("subfolder1/insubfolder1.txt"));
+    CHECK_FALSE(directory.exists("subfolder1"));
+    CHECK_FALSE(directory.exists("does-not-exist-file"));
+    CHECK(directory.open("does-not-exist-file") == nullptr);
+
+    StreamPtr stream = directory.open("subfolder1\\insubfolder1.txt");
+    REQUIRE(stream != nullptr);
+    const uint8_t* view = stream->tryGetContiguousView(0, 12);
+    REQUIRE(view != nullptr);
+    CHECK(memcmp(view, "insubfolder1", 12) == 0);
+
+    std::vector<Archive::path> files;
+    CHECK(directory.listFiles(files));
+    CHECK(contains(files, "test.txt"));
+    CHECK(contains(files, "subfolder1/insubfolder1.txt"));
+    CHECK(contains(files, "testArchive.mpq"));
+
+    DirectoryArchive invalidDirectory{"does-not-exist-directory"};
+    CHECK(invalidDirectory.fail());
+    CHECK_FALSE(invalidDirectory.exists("test.txt"));
+}
+
+#ifndef _WIN32
+/// @testimpl{WorldStone::DirectoryArchive,VirtualFileSystem}
+TEST_CASE("DirectoryArchive does not follow links to directories")
+{
+    // Make a directory that contains a file and a link to itself
+    const char* linkPath = "linkLoop/loop";
+    const char* filePath = "linkLoop/file.txt";
+    unlink(linkPath);
+    unlink(filePath);
+    rmdir("linkLoop");
+    REQUIRE(mkdir("linkLoop", 0755) == 0);
+    if (FILE* file = fopen(filePath, "w")) fclose(file);
+    const bool linkCreated = symlink(".", linkPath) == 0;
+
+    DirectoryArchive           directory{"linkLoop"};
+    std::vector<Archive::path> files;
+    CHECK(linkCreated);
+    CHECK(directory.listFiles(files));
+    CHECK(files == std::vector<Archive::path>{"file.txt"});
+    // Paths going through the link can still be opened
+    CHECK(directory.exists("loop/file.txt"));
+
+    unlink(linkPath);
+    unlink(filePath);
+    rmdir("linkLoop");
+}
+#endif
+
+/// @testimpl{WorldStone::VirtualFileSystem,VirtualFileSystem}
+TEST_CASE("VirtualFileSystem")
+{
+    SUBCASE("Sources with a higher priority hide the others")
+    {
+        for (bool directoryFirst : {true, false})
+        {
+            CAPTURE(directoryFirst);
+            VirtualFileSystem vfs;
+            REQUIRE(vfs.mount(std::make_unique<DirectoryArchive>("."), directoryFirst ? 1 : 0));
+            REQUIRE(vfs.mount(std::make_unique<NativeMpqArchive>("testArchive.mpq"),
+                              directoryFirst ? 0 : 1, testArchiveFiles));
+            Archive* const directory = &vfs.getSource(0);
+            Archive* const mpq       = &vfs.getSource(1);
+            CHECK(vfs.isThreadSafe());
+
+            // Lookups are case insensitive, and independent of the separators
+            for (const char* fileName : {"test.txt", "TEST.txt", "subfolder1\\insubfolder1.txt",
+                                         "SubFolder1/InSubFolder1.txt"})
+            {
+                CAPTURE(fileName);
+                CHECK(vfs.findSource(fileName) == (directoryFirst ? directory : mpq));
+                StreamPtr stream = vfs.open(fileName);
+                REQUIRE(stream != nullptr);
+                CHECK(stream->getc() != -1);
+            }
+            CHECK(vfs.findSource("testArchive.mpq") == directory);
+            CHECK_FALSE(vfs.exists("does-not-exist-file"));
+            CHECK(vfs.open("does-not-exist-file") == nullptr);
+        }
+    }
+    SUBCASE("With equal priorities, the last mounted source is used")
+    {
+        VirtualFileSystem vfs;
+        REQUIRE(
+            vfs.mount(std::make_unique<NativeMpqArchive>("testArchive.mpq"), 0, testArchiveFiles));
+        REQUIRE(vfs.mount(std::make_unique<DirectoryArchive>("."), 0));
+        CHECK(vfs.findSource("test.txt") == &vfs.getSource(1));
+    }
+    SUBCASE("Sources without a complete list of files")
+    {
+        VirtualFileSystem vfs;
+        REQUIRE(vfs.mount(std::make_unique<DirectoryArchive>("subfolder1"), 1));
+        // This archive has no list file, so we give it some names
+        REQUIRE(vfs.mount(std::make_unique<NativeMpqArchive>("nativeMpqTest.mpq"), 0,
+                          {"imploded.txt", "raw.txt", "not-in-archive.txt"}));
+        CHECK(vfs.getIndexSize() == 3);
+
+        std::vector<Archive::path> files;
+        CHECK_FALSE(vfs.listFiles(files));
+        CHECK(files.size() == 3);
+        CHECK(contains(files, "insubfolder1.txt"));
+        CHECK(contains(files, "imploded.txt"));
+        CHECK_FALSE(contains(files, "not-in-archive.txt"));
+
+        // Files that are not listed are still found by probing the archive
+        CHECK(vfs.exists("single.txt"));
+        StreamPtr stream = vfs.open("single.txt");
+        REQUIRE(stream != nullptr);
+        CHECK(stream->getc() == 'A');
+        CHECK_FALSE(vfs.exists("not-in-archive.txt"));
+
+        // Indexing again gives the same result
+        vfs.rebuildIndex();
+        CHECK(vfs.getIndexSize() == 3);
+        CHECK(vfs.exists("raw.txt"));
+    }
+    SUBCASE("A higher priority unlisted source still wins")
+    {
+        VirtualFileSystem vfs;
+        REQUIRE(vfs.mount(std::make_unique<DirectoryArchive>("."), 0));
+        REQUIRE(vfs.mount(std::make_unique<UnlistedArchive>(
+                              std::make_unique<NativeMpqArchive>("testArchive.mpq")),
+                          1));
+        Archive* const directory = &vfs.getSource(0);
+        Archive* const mpq       = &vfs.getSource(1);
+        CHECK(vfs.getIndexSize() > 0);
+        CHECK(vfs.findSource("test.txt") == mpq);
+        CHECK(vfs.findSource("subfolder1\\insubfolder1.txt") == mpq);
+        // Falls back to the index when the unlisted source does not have the file
+        CHECK(vfs.findSource("testArchive.mpq") == directory);
+        StreamPtr stream = vfs.open("testArchive.mpq");
+        REQUIRE(stream != nullptr);
+        CHECK(stream->getc() == 'M');
+
+        // Unlisted sources with a lower priority do not hide the indexed files
+        REQUIRE(vfs.mount(std::make_unique<UnlistedArchive>(
+                              std::make_unique<DirectoryArchive>(".")),
+                          -1));
+        CHECK(vfs.findSource("test.txt") == mpq);
+        CHECK(vfs.findSource("testArchive.mpq") == directory);
+    }
+    SUBCASE("MPQ archives are indexed by the hashes of their names")
+    {
+        VirtualFileSystem vfs;
+        REQUIRE(vfs.mount(std::make_unique<DirectoryArchive>("."), 0));
+        auto unlisted = std::make_unique<UnlistedArchive>(
+            std::make_unique<NativeMpqArchive>("testArchive.mpq"), true);
+        UnlistedArchive* const mpq = unlisted.get();
+        REQUIRE(vfs.mount(std::move(unlisted), 1));
+        Archive* const directory = &vfs.getSource(0);
+
+        CHECK(vfs.findSource("test.txt") == mpq);
+        CHECK(vfs.findSource("SubFolder1/InSubFolder1.txt") == mpq);
+        CHECK(vfs.findSource("testArchive.mpq") == directory);
+        CHECK_FALSE(vfs.exists("does-not-exist-file"));
+        StreamPtr stream = vfs.open("test.txt");
+        REQUIRE(stream != nullptr);
+        CHECK(stream->getc() == 't');
+        // The archive was never probed
+        CHECK(mpq->existsCalls == 0);
+
+        std::vector<Archive::path> files;
+        CHECK_FALSE(vfs.listFiles(files));
+    }
+    SUBCASE("Invalid sources are not mounted")
+    {
+        VirtualFileSystem vfs;
+        CHECK_FALSE(vfs.mount(std::make_unique<DirectoryArchive>("does-not-exist-directory"), 0));
+        CHECK_FALSE(vfs.mount(std::make_unique<NativeMpqArchive>("does-not-exist-file"), 0));
+        CHECK_FALSE(vfs.mount(nullptr, 0));
+        CHECK(vfs.getSourcesNumber() == 0);
+        CHECK_FALSE(vfs.exists("test.txt"));
+    }
+}
@@ -0,0 +1,266 @@
+#!/usr/bin/env python3
+"""Generates workingDirectory/nativeMpqTest.mpq, used by NativeMpqArchiveTests.cpp.
+
+The archive covers the cases of the MPQ format that NativeMpqArchive handles without zlib:
+PKWARE imploded sectors, encrypted files with and without an adjusted (FIX_KEY) key, single unit
+files, files stored without compression and files in multiple locales. It starts with 512 bytes
+of garbage, so that the reader has to search for the header, and uses 512 bytes sectors.
+
+nativeMpqBadSectorShift.mpq is the same archive with an invalid sector size shift.
+
+Usage: generateNativeMpqTest.py [output directory]
+"""
+import os
+import struct
+import sys
+
+M = 0xFFFFFFFF
+
+# Encryption table and hashes, see NativeMpqArchive.cpp
+cryptTable = [0] * 0x500
+seed = 0x00100001
+for index1 in range(0x100):
+    index2 = index1
+    for i in range(5):
+        seed = (seed * 125 + 3) % 0x2AAAAB
+        temp1 = (seed & 0xFFFF) << 16
+        seed = (seed * 125 + 3) % 0x2AAAAB
+        temp2 = seed & 0xFFFF
+        cryptTable[index2] = temp1 | temp2
+        index2 += 0x100
+
+
+def hashString(string, hashType):
+    seed1, seed2 = 0x7FED7FED, 0xEEEEEEEE
+    for c in string.upper().replace('/', '\\').encode():
+        seed1 = (cryptTable[(hashType << 8) + c] ^ ((seed1 + seed2) & M)) & M
+        seed2 = (c + seed1 + seed2 + (seed2 << 5) + 3) & M
+    return seed1
+
+
+def encrypt(data, key):
+    out = bytearray(data)
+    seed2 = 0xEEEEEEEE
+    for i in range(len(data) // 4):
+        seed2 = (seed2 + cryptTable[0x400 + (key & 0xFF)]) & M
+        value = struct.unpack_from('<I', data, i * 4)[0]
+        struct.pack_into('<I', out, i * 4, value ^ ((key + seed2) & M))
+        key = ((((~key) << 0x15) & M) + 0x11111111) & M | (key >> 0x0B)
+        seed2 = (value + seed2 + (seed2 << 5) + 3) & M
+    return bytes(out)
+
+
+# PKWARE DCL implode encoder, with raw literals. The code lengths are the ones of blast.c.
+lengthCodeLengths = [2, 35, 36, 53, 38, 23]
+distanceCodeLengths = [2, 20, 53, 230, 247, 151, 248]
+lengthBase = [3, 2, 4, 5, 6, 7, 8, 9, 10, 12, 16, 24, 40, 72, 136, 264]
+lengthExtraBits = [0, 0, 0, 0, 0, 0, 0, 0, 1, 2, 3, 4, 5, 6, 7, 8]
+
+
+def huffmanCodes(compactLengths):
+    lengths = []
+    for b in compactLengths:
+        lengths += [b & 15] * ((b >> 4) + 1)
+    codes = {}
+    code = 0
+    for length in range(1, 14):
+        for symbol, symbolLength in enumerate(lengths):
+            if symbolLength == length:
+                codes[symbol] = (code, length)
+                code += 1
+        code <<= 1
+    return codes
+
+
+lengthCodes = huffmanCodes(lengthCodeLengths)
+distanceCodes = huffmanCodes(distanceCodeLengths)
+
+
+class BitWriter:
+    def __init__(self):
+        self.out = bytearray()
+        self.buffer = 0
+        self.nbBits = 0
+
+    def bits(self, value, nbBits):
+        self.buffer |= value << self.nbBits
+        self.nbBits += nbBits
+        while self.nbBits >= 8:
+            self.out.append(self.buffer & 255)
+            self.buffer >>= 8
+            self.nbBits -= 8
+
+    def huffman(self, codeAndLength):
+        code, length = codeAndLength
+        # Huffman codes are stored bit-reversed and inverted
+        for i in range(length - 1, -1, -1):
+            self.bits(((code >> i) & 1) ^ 1, 1)
+
+    def finish(self):
+        if self.nbBits:
+            self.out.append(self.buffer & 255)
+        return bytes(self.out)
+
+
+def implode(data, dictionaryBits=4):
+    writer = BitWriter()
+    writer.bits(0, 8)  # Raw literals
+    writer.bits(dictionaryBits, 8)
+    i = 0
+    while i < len(data):
+        best = (0, 0)
+        for distance in range(1, min(i, 64 << dictionaryBits) + 1):
+            length = 0
+            while i + length < len(data) and length < 518 and \
+                    data[i + length] == data[i + length - distance]:
+                length += 1
+            if length > best[0] and (length > 2 or distance <= 256):
+                best = (length, distance)
+        if best[0] >= 2:
+            length, distance = best
+            symbol = [s for s in range(16)
+                      if lengthBase[s] <= length < lengthBase[s] + (1 << lengthExtraBits[s])][0]
+            writer.bits(1, 1)
+            writer.huffman(lengthCodes[symbol])
+            writer.bits(length - lengthBase[symbol], lengthExtraBits[symbol])
+            distanceBits = 2 if length == 2 else dictionaryBits
+            writer.huffman(distanceCodes[(distance - 1) >> distanceBits])
+            writer.bits((distance - 1) & ((1 << distanceBits) - 1), distanceBits)
+            i += length
+        else:
+            writer.bits(0, 1)
+            writer.bits(data[i], 8)
+            i += 1
+    # End of stream code
+    writer.bits(1, 1)
+    writer.huffman(lengthCodes[15])
+    writer.bits(255, 8)
+    return writer.finish()
+
+
+SECTOR_SIZE = 512
+FILE_EXISTS = 0x80000000
+FILE_IMPLODE = 0x100
+FILE_COMPRESS = 0x200
+FILE_ENCRYPTED = 0x10000
+FILE_FIX_KEY = 0x20000
+FILE_SINGLE_UNIT = 0x1000000
+COMPRESSION_PKWARE = b'\x08'
+
+
+def fileKey(name, filePosition, fileSize, flags):
+    key = hashString(name.replace('/', '\\').split('\\')[-1], 3)
+    if flags & FILE_FIX_KEY:
+        key = ((key + filePosition) ^ fileSize) & M
+    return key
+
+
+def buildFile(name, content, flags, filePosition):
+    """Returns the data of a file as stored in the archive, at the given position"""
+    key = fileKey(name, filePosition, len(content), flags) if flags & FILE_ENCRYPTED else 0
+    if not flags & (FILE_COMPRESS | FILE_IMPLODE):
+        sectors = [content[i:i + SECTOR_SIZE] for i in range(0, len(content), SECTOR_SIZE)]
+        if flags & FILE_ENCRYPTED:
+            sectors = [encrypt(s, (key + i) & M) for i, s in enumerate(sectors)]
+        return b''.join(sectors)
+
+    if flags & FILE_SINGLE_UNIT:
+        units = [content]
+    else:
+        units = [content[i:i + SECTOR_SIZE] for i in range(0, len(content), SECTOR_SIZE)]
+    sectors = []
+    for unit in units:
+        compressed = implode(unit)
+        if flags & FILE_COMPRESS:
+            compressed = COMPRESSION_PKWARE + compressed
+        # Sectors that do not get smaller are stored as is
+        sectors.append(compressed if len(compressed) < len(unit) else unit)
+    if flags & FILE_ENCRYPTED:
+        sectors = [encrypt(s, (key + i) & M) for i, s in enumerate(sectors)]
+    if flags & FILE_SINGLE_UNIT:
+        return sectors[0]
+
+    offsets = [4 * (len(sectors) + 1)]
+    for sector in sectors:
+        offsets.append(offsets[-1] + len(sector))
+    offsetTable = struct.pack('<%dI' % len(offsets), *offsets)
+    if flags & FILE_ENCRYPTED:
+        offsetTable = encrypt(offsetTable, (key - 1) & M)
+    return offsetTable + b''.join(sectors)
+
+
+def noise(size, seed):
+    """Bytes that do not compress, from a LCG also used by NativeMpqArchiveTests.cpp"""
+    state = seed
+    out = bytearray()
+    for i in range(size):
+        state = (state * 1103515245 + 12345) & M
+        out.append(state >> 24)
+    return bytes(out)
+
+
+# The second sector is stored uncompressed in a compressed file, and all sectors are encrypted
+encryptedContent = (b'worldstone ' * 47)[:512] + noise(512, 1234) + bytes(range(256)) + b'\0' * 20
+
+# name, locale, content, flags
+files = [
+    ('imploded.txt', 0, b'AIAIAIAIAIAIA', FILE_EXISTS | FILE_IMPLODE),
+    ('data\\encrypted.bin', 0, encryptedContent,
+     FILE_EXISTS | FILE_COMPRESS | FILE_ENCRYPTED | FILE_FIX_KEY),
+    ('single.txt', 0, b'A single unit file, ' * 8,
+     FILE_EXISTS | FILE_COMPRESS | FILE_ENCRYPTED | FILE_SINGLE_UNIT),
+    ('raw.txt', 0, b'stored without compression', FILE_EXISTS),
+    ('encryptedonly.bin', 0, bytes((i * 7) & 255 for i in range(700)),
+     FILE_EXISTS | FILE_ENCRYPTED),
+    ('locale.txt', 0x409, b'english', FILE_EXISTS),
+    ('locale.txt', 0, b'neutral', FILE_EXISTS),
+]
+
+
+def buildArchive():
+    headerSize = 32
+    data = bytearray()
+    blocks = []
+    for name, locale, content, flags in files:
+        filePosition = headerSize + len(data)
+        if name == 'imploded.txt':
+            # The test vector of blast.c, a single sector with its offset table
+            fileData = struct.pack('<2I', 8, 16) + bytes.fromhex('00048224258f807f')
+        else:
+            fileData = buildFile(name, content, flags, filePosition)
+        blocks.append((filePosition, len(fileData), len(content), flags))
+        data += fileData
+
+    hashTableSize = 16
+    hashTable = [(M, M, 0xFFFF, 0xFFFF, M)] * hashTableSize
+    for blockIndex, (name, locale, content, flags) in enumerate(files):
+        i = hashString(name, 0) % hashTableSize
+        while hashTable[i][4] != M:
+            i = (i + 1) % hashTableSize
+        hashTable[i] = (hashString(name, 1), hashString(name, 2), locale, 0, blockIndex)
+    hashTableData = b''.join(struct.pack('<IIHHI', *entry) for entry in hashTable)
+    blockTableData = b''.join(struct.pack('<4I', *entry) for entry in blocks)
+
+    hashTablePosition = headerSize + len(data)
+    blockTablePosition = hashTablePosition + len(hashTableData)
+    archiveSize = blockTablePosition + len(blockTableData)
+    header = struct.pack('<4s2I2H4I', b'MPQ\x1a', headerSize, archiveSize, 0,
+                         0,  # Sectors of 512 << 0 bytes
+                         hashTablePosition, blockTablePosition, hashTableSize, len(blocks))
+    return (b'\xAB' * 512 + header + bytes(data) +
+            encrypt(hashTableData, hashString('(hash table)', 3)) +
+            encrypt(blockTableData, hashString('(block table)', 3)))
+
+
+if __name__ == '__main__':
+    outputDirectory = sys.argv[1] if len(sys.argv) > 1 else os.path.join(
+        os.path.dirname(os.path.abspath(__file__)), 'workingDirectory')
+    archive = buildArchive()
+    with open(os.path.join(outputDirectory, 'nativeMpqTest.mpq'), 'wb') as output:
+        output.write(archive)
+
+    # The sector size shift is the 16 bits at offset 14 of the header, which follows the garbage
+    badSectorShift = bytearray(archive)
+    struct.pack_into('<H', badSectorShift, 512 + 14, 0xF700)
+    with open(os.path.join(outputDirectory, 'nativeMpqBadSectorShift.mpq'), 'wb') as output:
+        output.write(badSectorShift)
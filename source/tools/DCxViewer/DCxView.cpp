@@ -71,14 +71,11 @@ DCCSprite::DCCSprite(StreamPtr&& streamPtr)
                                                     header.framesPerDir, header.tag));
 
     const size_t nbDirs = header.directions;
-    directions.resize(nbDirs);
     directionImgProviders.resize(nbDirs);
-    for (uint32_t dirIndex = 0; dirIndex < nbDirs; dirIndex++)
-    {
-        DCC::Direction& dir = directions[dirIndex];
-        dcc.readDirection(dir, dirIndex, directionImgProviders[dirIndex]);
-    }
-    valid = true;
+    valid = dcc.readAllDirections(directions, DCxViewerApp::instance()->getThreadPool(),
+                                  [this](uint32_t dirIndex) -> ImgProvider& {
+                                      return directionImgProviders[dirIndex];
+                                  });
 }
 
 QString DCCSprite::getFrameHeaderDesc(size_t dir, size_t frameIndex) const
@@ -47,12 +47,16 @@ void DCxViewerApp::openMpq(const QUrl& mpqFileUrl)
         mpqFileName = mpqFileUrl.toLocalFile();
     else
         mpqFileName = mpqFileUrl.toString();
-    mpqArchive      = std::make_unique<MpqArchive>(mpqFileName.toStdString());
-    if (!mpqArchive->good()) qDebug() << "Failed to open" << mpqFileName << ".";
-    if (!listFileName.isEmpty())
-    {
-        mpqArchive->addListFile(listFileName.toStdString());
-    }
+    mountMpq();
+}
+
+void DCxViewerApp::mountMpq()
+{
+    auto archive = std::make_unique<NativeMpqArchive>(mpqFileName.toStdString());
+    if (!archive->good()) qDebug() << "Failed to open" << mpqFileName << ".";
+    fileSystem = std::make_unique<WorldStone::VirtualFileSystem>();
+    // The names of the list file are added to the ones of the archive own list file
+    if (!fileSystem->mount(std::move(archive), 0, readListFile())) fileSystem.reset();
     updateMpqFileList();
 }
 
@@ -62,11 +66,22 @@ void DCxViewerApp::addListFile(const QUrl& listFileUrl)
         listFileName = listFileUrl.toLocalFile();
     else
         listFileName = listFileUrl.toString();
-    if (mpqArchive)
+    // Mounting the archive again is cheap, it is memory mapped
+    if (fileSystem) mountMpq();
+}
+
+std::vector<std::string> DCxViewerApp::readListFile() const
+{
+    std::vector<std::string> names;
+    QFile                    listFile(listFileName);
+    if (listFileName.isEmpty() || !listFile.open(QIODevice::ReadOnly)) return names;
+    QByteArray content = listFile.readAll();
+    content.replace(';', '\n').replace('\r', '\n');
+    for (const QByteArray& name : content.split('\n'))
     {
-        mpqArchive->addListFile(listFileName.toStdString());
-        updateMpqFileList();
+        if (!name.isEmpty()) names.push_back(name.toStdString());
     }
+    return names;
 }
 
 void DCxViewerApp::setPaletteFile(const QUrl& paletteUrl)
@@ -80,8 +95,9 @@ void DCxViewerApp::setPaletteFile(const QUrl& paletteUrl)
 
 void DCxViewerApp::updateMpqFileList()
 {
-    if (!mpqArchive)return;
-    std::vector<MpqArchive::path> files = mpqArchive->findFiles();
+    if (!fileSystem) return;
+    std::vector<WorldStone::Archive::path> files;
+    fileSystem->listFiles(files);
     mpqFiles.clear();
     emit fileListUpdated();
     for (std::string & file : files)
@@ -98,21 +114,20 @@ void DCxViewerApp::setFileList(QStringList & newMpqFilesList)
 
 WorldStone::StreamPtr DCxViewerApp::getFilePtr(const QString& fileName)
 {
-    WorldStone::StreamPtr stream;
-    QString               fileNameBackslashes = fileName;
-    fileNameBackslashes.replace('/', '\\');
     qDebug() << "getFilePtr(" << fileName << ")";
-    stream = mpqArchive->open(fileNameBackslashes.toStdString());
-    if (!stream) {
-        stream = std::make_unique<WorldStone::FileStream>(fileName.toStdString());
-        if (stream->fail()) stream = nullptr;
+    // Such as the palette, which is not read from the archives
+    if (QFileInfo(fileName).isAbsolute()) {
+        WorldStone::StreamPtr stream =
+            std::make_unique<WorldStone::FileStream>(fileName.toStdString());
+        return stream->fail() ? nullptr : std::move(stream);
     }
-    return stream;
+    // The file system does not care about the case and separators
+    return fileSystem ? fileSystem->open(fileName.toStdString()) : nullptr;
 }
 
 void DCxViewerApp::fileActivated(const QString& fileName)
 {
-    if (!mpqArchive) return;
+    if (!fileSystem) return;
     if (fileName.endsWith(".dc6", Qt::CaseInsensitive) ||
         fileName.endsWith(".dcc", Qt::CaseInsensitive))
     {
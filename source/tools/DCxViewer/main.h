@@ -1,13 +1,15 @@
 #pragma once
 #include <DCxView.h>
-#include <MpqArchive.h>
+#include <NativeMpqArchive.h>
 #include <QApplication>
 #include <QListWidget>
 #include <QMainWindow>
 #include <QUrl>
+#include <ThreadPool.h>
+#include <VirtualFileSystem.h>
 #include <memory>
 
-using WorldStone::MpqArchive;
+using WorldStone::NativeMpqArchive;
 
 class DCxViewerApp : public QApplication
 {
@@ -15,9 +17,16 @@ class DCxViewerApp : public QApplication
 private:
     QString mpqFileName;
     QString listFileName;
-    QString                     paletteFile; //< The opened palette
-    std::unique_ptr<MpqArchive> mpqArchive;
-    QStringList                 mpqFiles;
+    QString                                        paletteFile; //< The opened palette
+    /// Made of the MPQ archive, whose decompressed sectors are kept in the global SectorCache
+    std::unique_ptr<WorldStone::VirtualFileSystem> fileSystem;
+    QStringList                                    mpqFiles;
+    WorldStone::ThreadPool                         threadPool;
+
+    /// Mounts mpqFileName in a new file system, with the names of the list file
+    void mountMpq();
+    /// Names of the files of the list file, separated by new lines or semicolons
+    std::vector<std::string> readListFile() const;
 
 public:
     DCxViewerApp(int& argc, char** argv);
@@ -34,8 +43,11 @@ public:
     void setFileList(QStringList & newMpqFilesList);
     void updateMpqFileList();
     QString getMpqFileName() { return mpqFileName; }
-    /// @warning Be careful not to read multiple files at the same time, it is not supported by
-    /// StormLib
+    /// Thread pool used to decode the files
+    WorldStone::ThreadPool& getThreadPool() { return threadPool; }
+    /**Opens a file from the file system made of the MPQ archive, or from the disk for absolute
+     * paths. Can be called from any thread.
+     */
     WorldStone::StreamPtr getFilePtr(const QString& fileName);
 
 public slots :